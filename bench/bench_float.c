@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <json.h>
+
+/*
+ * Float parsing on a GeoJSON-like corpus: a FeatureCollection of polygons
+ * whose coordinates are [longitude, latitude] pairs with up to 15 decimals.
+ *
+ *   bench_float [features]
+ */
+
+struct corpus_t {
+    char *text;
+    size_t len;
+    /* start and length of every coordinate */
+    size_t *starts;
+    size_t *lens;
+    size_t count;
+};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void corpus_append(struct corpus_t *c, size_t *capacity, const char *s, size_t len) {
+    if (c->len + len + 1 > *capacity) {
+        while (c->len + len + 1 > *capacity)
+            *capacity *= 2;
+        c->text = (char *)realloc(c->text, *capacity);
+    }
+    memcpy(c->text + c->len, s, len);
+    c->len += len;
+    c->text[c->len] = '\0';
+}
+
+static void corpus_append_coordinate(struct corpus_t *c, size_t *capacity, size_t *number_capacity, double value) {
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%.*f", 6 + (int)(next_random() % 10), value);
+
+    if (c->count == *number_capacity) {
+        *number_capacity *= 2;
+        c->starts = (size_t *)realloc(c->starts, *number_capacity * sizeof(size_t));
+        c->lens = (size_t *)realloc(c->lens, *number_capacity * sizeof(size_t));
+    }
+    c->starts[c->count] = c->len;
+    c->lens[c->count] = (size_t)len;
+    c->count++;
+    corpus_append(c, capacity, buf, (size_t)len);
+}
+
+static struct corpus_t make_corpus(size_t features) {
+    struct corpus_t c = {0};
+    size_t capacity = 1 << 16, number_capacity = 1 << 12;
+    const char *head = "{\"type\":\"FeatureCollection\",\"features\":[";
+
+    c.text = (char *)malloc(capacity);
+    c.starts = (size_t *)malloc(number_capacity * sizeof(size_t));
+    c.lens = (size_t *)malloc(number_capacity * sizeof(size_t));
+    corpus_append(&c, &capacity, head, strlen(head));
+
+    for (size_t f = 0; f < features; f++) {
+        const char *feature = "{\"type\":\"Feature\",\"properties\":{},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[";
+        double lon = (double)(next_random() % 360000000) / 1e6 - 180;
+        double lat = (double)(next_random() % 180000000) / 1e6 - 90;
+        size_t points = 16 + next_random() % 48;
+
+        if (f)
+            corpus_append(&c, &capacity, ",", 1);
+        corpus_append(&c, &capacity, feature, strlen(feature));
+        for (size_t p = 0; p < points; p++) {
+            double dlon = (double)(next_random() % 2000000) / 1e9 - 0.001;
+            double dlat = (double)(next_random() % 2000000) / 1e9 - 0.001;
+            if (p)
+                corpus_append(&c, &capacity, ",", 1);
+            corpus_append(&c, &capacity, "[", 1);
+            corpus_append_coordinate(&c, &capacity, &number_capacity, lon + dlon);
+            corpus_append(&c, &capacity, ",", 1);
+            corpus_append_coordinate(&c, &capacity, &number_capacity, lat + dlat);
+            corpus_append(&c, &capacity, "]", 1);
+        }
+        corpus_append(&c, &capacity, "]]}}", 4);
+    }
+    corpus_append(&c, &capacity, "]}", 2);
+    return c;
+}
+
+static void report(const char *name, const struct corpus_t *c, double seconds, int rounds) {
+    printf("%-28s %8.2f ms %8.1f MB/s %8.2f ns/number\n", name, seconds * 1e3 / rounds,
+           c->len * rounds / seconds / 1e6, seconds * 1e9 / rounds / c->count);
+}
+
+int main(int argc, char **argv) {
+    size_t features = argc > 1 ? strtoul(argv[1], NULL, 10) : 5000;
+    const int rounds = 5;
+    struct corpus_t c = make_corpus(features);
+    double expected = 0, sum = 0, start;
+    char buf[32];
+
+    printf("corpus: %zu features, %zu numbers, %.2f MB\n", features, c.count, c.len / 1e6);
+
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < c.count; i++) {
+            // strtod needs a terminated string, copy like a JT_NUMBER would
+            memcpy(buf, c.text + c.starts[i], c.lens[i]);
+            buf[c.lens[i]] = '\0';
+            expected += strtod(buf, NULL);
+        }
+    }
+    report("strtod", &c, now() - start, rounds);
+
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < c.count; i++) {
+            double value;
+            json_parse_double(c.text + c.starts[i], c.lens[i], &value);
+            sum += value;
+        }
+    }
+    report("json_parse_double", &c, now() - start, rounds);
+
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        union json_t j = json_deserialize(c.text);
+        json_clean(&j);
+    }
+    report("json_deserialize", &c, now() - start, rounds);
+
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        union json_t j = json_deserialize_with(c.text, .typed_numbers = true);
+        json_clean(&j);
+    }
+    report("json_deserialize typed", &c, now() - start, rounds);
+
+    /* also keeps the conversions from being optimized out */
+    if (sum != expected)
+        printf("checksum mismatch: %.17g != %.17g\n", sum, expected);
+
+    free(c.text);
+    free(c.starts);
+    free(c.lens);
+    return sum != expected;
+}
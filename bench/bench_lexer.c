@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <json.h>
+
+/*
+ * Lexing alone, token list included, on inputs that stress each token kind:
+ * short records, numbers, literals and indented text with many newlines.
+ * Run it with JSON_SIMD_KERNEL=scalar for the portable baseline.
+ *
+ *   bench_lexer [records]
+ */
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* [{"id":0,"name":"n0","ok":true},{"id":1,...}, ...] */
+static char *make_records(size_t records) {
+    char *text = (char *)malloc(records * 64 + 3);
+    char *p = text;
+
+    *p++ = '[';
+    for (size_t i = 0; i < records; i++)
+        p += sprintf(p, "%s{\"id\":%zu,\"name\":\"n%zu\",\"ok\":%s}", i ? "," : "", i, i, i % 2 ? "true" : "false");
+    *p++ = ']';
+    *p = '\0';
+    return text;
+}
+
+/* [0,-1.5,2e10,...] */
+static char *make_numbers(size_t records) {
+    char *text = (char *)malloc(records * 4 * 24 + 3);
+    char *p = text;
+
+    *p++ = '[';
+    for (size_t i = 0; i < 4 * records; i++)
+        p += sprintf(p, "%s%s", i ? "," : "", i % 3 == 0 ? "12345" : i % 3 == 1 ? "-1.5" : "6.02e23");
+    *p++ = ']';
+    *p = '\0';
+    return text;
+}
+
+/* [true,false,null,...] */
+static char *make_literals(size_t records) {
+    char *text = (char *)malloc(records * 4 * 6 + 3);
+    char *p = text;
+
+    *p++ = '[';
+    for (size_t i = 0; i < 4 * records; i++)
+        p += sprintf(p, "%s%s", i ? "," : "", i % 3 == 0 ? "true" : i % 3 == 1 ? "false" : "null");
+    *p++ = ']';
+    *p = '\0';
+    return text;
+}
+
+/* The records, one member per line with four spaces of indent */
+static char *make_pretty(size_t records) {
+    char *text = (char *)malloc(records * 96 + 5);
+    char *p = text;
+
+    p += sprintf(p, "[\n");
+    for (size_t i = 0; i < records; i++)
+        p += sprintf(p, "%s  {\n    \"id\": %zu,\n    \"name\": \"n%zu\",\n    \"ok\": %s\n  }", i ? ",\n" : "", i, i,
+                     i % 2 ? "true" : "false");
+    p += sprintf(p, "\n]");
+    return text;
+}
+
+static void run(const char *name, char *text, int rounds) {
+    size_t len = strlen(text);
+    size_t tokens = 0;
+    double start = now();
+
+    for (int r = 0; r < rounds; r++) {
+        struct json_lexer_context_t *lexer = json_create_lexer(text);
+        json_execute_lexer(lexer);
+        tokens = lexer->tokens.length;
+        json_delete_lexer(lexer);
+    }
+
+    double seconds = now() - start;
+    printf("%-8s %8.3f ms %8.1f MB/s %8.1f Mtok/s\n", name, seconds * 1e3 / rounds, len * rounds / seconds / 1e6,
+           tokens * rounds / seconds / 1e6);
+    free(text);
+}
+
+int main(int argc, char **argv) {
+    size_t records = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    const char *kernel = getenv("JSON_SIMD_KERNEL");
+
+    printf("%zu records, kernel: %s\n", records, kernel && *kernel ? kernel : "auto");
+    run("records", make_records(records), 20);
+    run("numbers", make_numbers(records), 20);
+    run("literals", make_literals(records), 20);
+    run("pretty", make_pretty(records), 20);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <json.h>
+
+/*
+ * Newline-delimited JSON on 1, 2, 4, ... threads up to the number of online
+ * CPUs, or a file given on the command line.
+ *
+ *   bench_ndjson [records | file.ndjson]
+ */
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* {"id":0,"name":"n0","tags":["a","b"],"ok":true}\n ... */
+static char *make_lines(size_t records, size_t *len) {
+    char *text = (char *)malloc(records * 96 + 1);
+    char *p = text;
+
+    for (size_t i = 0; i < records; i++)
+        p += sprintf(p, "{\"id\":%zu,\"name\":\"n%zu\",\"tags\":[\"a\",\"b\"],\"score\":%zu.5,\"ok\":%s}\n", i, i,
+                     i % 1000, i % 2 ? "true" : "false");
+    *len = p - text;
+    return text;
+}
+
+int main(int argc, char **argv) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = online > 0 ? (size_t)online : 1;
+    const char *file = argc > 1 && strspn(argv[1], "0123456789") != strlen(argv[1]) ? argv[1] : NULL;
+    size_t records = argc > 1 && !file ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t len = 0;
+    char *text = file ? NULL : make_lines(records, &len);
+
+    printf("%s, %zu online CPUs\n", file ? file : "generated", max_threads);
+
+    for (size_t threads = 1;; threads *= 2) {
+        if (threads > max_threads)
+            threads = max_threads;
+
+        struct json_record_t *out = NULL;
+        double start = now();
+        size_t count = file ? json_ndjson_file(file, &out, .threads = threads)
+                            : json_ndjson_parse(text, len, &out, .threads = threads);
+        double seconds = now() - start;
+
+        json_ndjson_free(out, count);
+        printf("%2zu threads %9zu records %8.3f ms", threads, count, seconds * 1e3);
+        if (!file)
+            printf(" %8.1f MB/s", len / seconds / 1e6);
+        printf("\n");
+
+        if (threads == max_threads)
+            break;
+    }
+
+    free(text);
+    return 0;
+}
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <json.h>
+
+/*
+ * Recursive and iterative parsing on a deep input (nested arrays and
+ * objects), a wide one (one flat array of small records), a text one
+ * (an array of long non-ASCII strings) and a members one (a single object
+ * with one member per record), against lexing alone, json_validate and a
+ * parse on every online CPU.
+ *
+ *   bench_parse [depth] [records]
+ */
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* [{"a":[{"a":[ ... 1 ... ]}]}] */
+static char *make_deep(size_t depth) {
+    char *text = (char *)malloc(depth * 14 + 2);
+    char *p = text;
+
+    for (size_t i = 0; i < depth; i++)
+        p += sprintf(p, i % 2 ? "{\"a\":" : "[");
+    *p++ = '1';
+    for (size_t i = depth; i > 0; i--)
+        *p++ = (i - 1) % 2 ? '}' : ']';
+    *p = '\0';
+    return text;
+}
+
+/* [{"id":0,"name":"n0","ok":true},{"id":1,...}, ...] */
+static char *make_wide(size_t records) {
+    char *text = (char *)malloc(records * 64 + 3);
+    char *p = text;
+
+    *p++ = '[';
+    for (size_t i = 0; i < records; i++)
+        p += sprintf(p, "%s{\"id\":%zu,\"name\":\"n%zu\",\"ok\":%s}", i ? "," : "", i, i, i % 2 ? "true" : "false");
+    *p++ = ']';
+    *p = '\0';
+    return text;
+}
+
+/* {"k0":0,"k1":1,...} */
+static char *make_members(size_t records) {
+    char *text = (char *)malloc(records * 48 + 3);
+    char *p = text;
+
+    *p++ = '{';
+    for (size_t i = 0; i < records; i++)
+        p += sprintf(p, "%s\"k%zu\":%zu", i ? "," : "", i, i);
+    *p++ = '}';
+    *p = '\0';
+    return text;
+}
+
+/* ["caf\u00e9 ... \u20ac ... \U0001F600", ...], about 128 bytes per string */
+static char *make_text(size_t strings) {
+    const char *words[] = {"lorem", "ipsum", "caf\xc3\xa9", "na\xc3\xafve", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "dolor"};
+    char *text = (char *)malloc(strings * 160 + 3);
+    char *p = text;
+
+    *p++ = '[';
+    for (size_t i = 0; i < strings; i++) {
+        char *start = p;
+
+        p += sprintf(p, "%s\"", i ? "," : "");
+        while (p - start < 128)
+            p += sprintf(p, "%s ", words[(i + p - start) % 7]);
+        *p++ = '"';
+    }
+    *p++ = ']';
+    *p = '\0';
+    return text;
+}
+
+static union json_t parse_with(const char *text, void (*parse)(struct json_parser_context_t *)) {
+    struct json_lexer_context_t *lexer = json_create_lexer(text);
+    struct json_parser_context_t *parser = json_create_parser(lexer);
+
+    parser->on_demand = true;
+    parser->config.max_depth = SIZE_MAX;
+    parse(parser);
+
+    union json_t j = parser->root;
+    json_delete_lexer(lexer);
+    json_delete_parser(parser);
+    return j;
+}
+
+static void report(const char *name, const char *label, size_t len, double seconds, int rounds) {
+    printf("%-6s %-10s %8.3f ms %8.1f MB/s\n", name, label, seconds * 1e3 / rounds, len * rounds / seconds / 1e6);
+}
+
+static bool count_event(const char *text, size_t len, void *args) {
+    (void)text;
+    *(size_t *)args += len;
+    return true;
+}
+
+static void run(const char *name, const char *text, int rounds) {
+    size_t len = strlen(text);
+    void (*parsers[])(struct json_parser_context_t *) = {json_parse_recursive, json_parse};
+    const char *labels[] = {"recursive", "iterative"};
+
+    for (int k = 0; k < 2; k++) {
+        double start = now();
+        for (int r = 0; r < rounds; r++) {
+            union json_t j = parse_with(text, parsers[k]);
+            json_clean(&j);
+        }
+        report(name, labels[k], len, now() - start, rounds);
+    }
+
+    double start = now();
+    for (int r = 0; r < rounds; r++) {
+        struct json_lexer_context_t *lexer = json_create_lexer(text);
+        json_execute_lexer(lexer);
+        json_delete_lexer(lexer);
+    }
+    report(name, "lexer", len, now() - start, rounds);
+
+    // the UTF-8 check costs the difference between these two
+    for (int validate = 0; validate < 2; validate++) {
+        start = now();
+        for (int r = 0; r < rounds; r++) {
+            union json_t j = json_deserialize_n_with(text, len, .validate_utf8 = validate);
+            json_clean(&j);
+        }
+        report(name, validate ? "utf8" : "parse", len, now() - start, rounds);
+    }
+
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        if (json_validate(text, len).code != JSON_ERROR_NONE)
+            printf("%s: unexpected validation error\n", name);
+    }
+    report(name, "validate", len, now() - start, rounds);
+
+    // roots under JSON_PARALLEL_MIN stay on one thread
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        union json_t j = json_deserialize_n_with(text, len, .threads = threads > 1 ? threads : 2);
+        json_clean(&j);
+    }
+    report(name, "parallel", len, now() - start, rounds);
+
+    // the second element is absent from deep and tiny in wide, so nearly everything is skipped
+    const char *paths[] = {"/1"};
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        union json_t j = json_deserialize_paths(text, len, paths, 1);
+        json_clean(&j);
+    }
+    report(name, "paths", len, now() - start, rounds);
+
+    size_t events = 0;
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        if (json_sax_parse(text, len, .string = count_event, .number = count_event, .args = &events).code)
+            printf("%s: unexpected SAX error\n", name);
+    }
+    report(name, "sax", len, now() - start, rounds);
+
+    // reads one field of every record in wide, skips deep whole
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        struct json_cursor_t *c = json_cursor_new(text, len);
+        int64_t id, sum = 0;
+
+        if (json_cursor_enter_array(c)) {
+            while (json_cursor_next(c)) {
+                if (json_cursor_enter_object(c) && json_cursor_find(c, "id") && json_cursor_get_i64(c, &id))
+                    sum += id;
+                while (c->depth > 1 && json_cursor_next(c))
+                    ;
+            }
+        }
+        if (c->error.code || sum < 0)
+            printf("%s: unexpected cursor error\n", name);
+        json_cursor_free(c);
+    }
+    report(name, "cursor", len, now() - start, rounds);
+}
+
+int main(int argc, char **argv) {
+    size_t depth = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+    size_t records = argc > 2 ? strtoul(argv[2], NULL, 10) : 100000;
+    char *deep = make_deep(depth);
+    char *wide = make_wide(records);
+    char *text = make_text(records);
+    char *members = make_members(records);
+
+    printf("deep: %zu levels, wide: %zu records, text: %zu strings, members: %zu\n", depth, records, records,
+           records);
+    run("deep", deep, 2000);
+    run("wide", wide, 10);
+    run("text", text, 10);
+    run("members", members, 10);
+
+    free(deep);
+    free(wide);
+    free(text);
+    free(members);
+    return 0;
+}
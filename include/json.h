@@ -139,6 +139,24 @@ struct json_pair_t {
 
 const char *json_type2str(enum json_token_type_t type);
 
+// --------------------------------------------------
+//                  JSON Memory
+// --------------------------------------------------
+
+/*
+ * Nodes, pairs, keys and strings are allocated through these functions,
+ * extension modules must use them too. While a document is active on the
+ * calling thread (see json_doc_begin) they allocate from its arena and
+ * json_free does nothing.
+ */
+void *json_malloc(size_t size);
+void *json_calloc(size_t count, size_t size);
+void json_free(void *ptr);
+
+// --------------------------------------------------
+//                  END JSON Memory
+// --------------------------------------------------
+
 // --------------------------------------------------
 //     JSON UNDER LAYER DATA STRUCTURE EXTENSION
 // --------------------------------------------------
@@ -150,6 +168,10 @@ void jsonext_obj_new(union json_t *j, size_t capacity);
 void jsonext_arr_new(union json_t *j, size_t capacity);
 
 void jsonext_obj_insert(union json_t *j, struct json_pair_t *pair);
+/* Make room for length pairs in total, so inserting them does not grow the object. False if out of memory. */
+bool jsonext_obj_reserve(union json_t *j, size_t length);
+/* Insert pair unless its key is present. Return the pair that holds the key, NULL when out of memory. */
+struct json_pair_t *jsonext_obj_emplace(union json_t *j, struct json_pair_t *pair);
 void jsonext_arr_append(union json_t *j, union json_t *value);
 
 struct json_pair_t *jsonext_obj_get(union json_t *j, const char *key);
@@ -423,6 +445,43 @@ void __json_dump(union json_t j, FILE *f, struct json_config config);
 void __json_pprint(union json_t j, struct json_config config);
 void json_print(union json_t j);
 
+// --------------------------------------------------
+//                    JSON Error
+// --------------------------------------------------
+enum json_error_code {
+    JSON_ERROR_NONE,
+    JSON_ERROR_INVALID_CHAR,
+    JSON_ERROR_INVALID_LITERAL,
+    JSON_ERROR_INVALID_NUMBER,
+    JSON_ERROR_INVALID_STRING,
+    JSON_ERROR_INVALID_ESCAPE,
+    JSON_ERROR_UNEXPECTED_TOKEN,
+    JSON_ERROR_UNEXPECTED_EOF,
+    JSON_ERROR_TRAILING_DATA,
+    JSON_ERROR_DEPTH,
+    JSON_ERROR_INVALID_UTF8,
+    JSON_ERROR_NO_MEMORY,
+    JSON_ERROR_ABORTED,
+    JSON_ERROR_IO,
+    JSON_ERROR_CODE_SIZE
+};
+
+/*
+ * First error of a parse. Offset is the byte where it was found, row and
+ * column count from 1 and are only filled in when a parse is reported.
+ */
+struct json_error_t {
+    enum json_error_code code;
+    size_t offset;
+    size_t row;
+    size_t column;
+};
+
+const char *json_error2str(enum json_error_code code);
+// --------------------------------------------------
+//                  END JSON Error
+// --------------------------------------------------
+
 // --------------------------------------------------
 //                    JSON Lexer
 // --------------------------------------------------
@@ -448,23 +507,66 @@ struct json_lexer_token_t {
     size_t index;
     size_t start;
     size_t end;
+    /* Only filled by json_lexer_token_at(), 0 while lexing */
     size_t column;
     size_t row;
 };
 
+/*
+ * Compact token of the token list (tape): 8 bytes holding the lexer type in
+ * the top 8 bits and the byte offset of the token's first character in the
+ * low 56 bits. The end comes from the length kept beside the tape, row and
+ * column are recomputed from the offset, see json_lexer_token_at().
+ */
+typedef uint64_t json_tape_t;
+
+#define JSON_TAPE(type, offset) (((uint64_t)(type) << 56) | ((uint64_t)(offset) & 0x00FFFFFFFFFFFFFFULL))
+#define JSON_TAPE_TYPE(t) ((enum json_lexer_token_type_t)((t) >> 56))
+#define JSON_TAPE_OFFSET(t) ((size_t)((t) & 0x00FFFFFFFFFFFFFFULL))
+
+/* Length of a token too long for the lengths array, the token is lexed again instead */
+#define JSON_TAPE_LONG UINT32_MAX
+
 struct json_lexer_container_t {
     size_t length;
     size_t capacity;
-    struct json_lexer_token_t *list;
+    json_tape_t *list;
+    /* Text length of each token, quotes excluded, or JSON_TAPE_LONG */
+    uint32_t *lengths;
+};
+
+/* Carries of the structural index between 64-byte blocks */
+struct json_stage1_t {
+    uint64_t prev_escaped;
+    uint64_t prev_in_string;
+    uint64_t prev_scalar;
 };
 
 struct json_lexer_context_t {
     struct json_lexer_container_t tokens;
     size_t offset;
-    size_t column;
-    size_t row;
     const char *from_string;
     size_t from_string_len;
+    /* Structural index: unconsumed bits of the block at structurals_base */
+    struct json_stage1_t stage1;
+    uint64_t structurals;
+    size_t structurals_base;
+    size_t stage1_offset;
+    /* Bitmaps of every block computed ahead, used instead of the stage 1 kernels if set */
+    const uint64_t *index;
+    /* Reject strings that are not well-formed UTF-8 with JSON_ERROR_INVALID_UTF8 */
+    bool validate_utf8;
+    /* Set on the first invalid byte, the lexer then stops at the end of the input */
+    struct json_error_t error;
+    /*
+     * Start offsets of rows 2, 3, ..., found by json_lexer_position() the
+     * first time a position past them is asked for. Lexing itself only
+     * tracks byte offsets.
+     */
+    size_t *line_starts;
+    size_t line_count;
+    size_t line_capacity;
+    size_t lines_scanned; /* input before this offset has been searched for '\n' */
 };
 
 const char *json_lexer_type2str(enum json_lexer_token_type_t type);
@@ -473,28 +575,598 @@ struct json_lexer_context_t *json_create_lexer(const char *from_string);
 void json_delete_lexer(struct json_lexer_context_t *ctx);
 void json_execute_lexer(struct json_lexer_context_t *ctx);
 void json_print_lexer(struct json_lexer_context_t *ctx);
+struct json_lexer_token_t json_lexer_token_at(struct json_lexer_context_t *ctx, size_t index);
+/* 1-based row and column of byte `offset` of the input, '\n' starts a new row. */
+void json_lexer_position(struct json_lexer_context_t *ctx, size_t offset, size_t *row, size_t *column);
 
 // --------------------------------------------------
 //                END JSON Lexer
 // --------------------------------------------------
 
+// --------------------------------------------------
+//                  JSON Number
+// --------------------------------------------------
+/*
+ * Convert the JSON number text[0..len) to the nearest double without strtod,
+ * so the result does not depend on the locale. Return false if the text is
+ * not a JSON number. Out of range values become +-HUGE_VAL or zero.
+ */
+bool json_parse_double(const char *text, size_t len, double *out);
+
+/*
+ * Replace a JT_NUMBER by its JT_INT, JT_UINT or JT_FLOAT value. Return false
+ * and keep the text if it is not a number or does not fit.
+ */
+bool json_decode_number(union json_t *j);
+// --------------------------------------------------
+//                  END JSON Number
+// --------------------------------------------------
+
 // --------------------------------------------------
 //                  JSON Parser
 // --------------------------------------------------
+struct json_doc_t;
+
+/* Default nesting limit of json_parse */
+#define JSON_MAX_DEPTH 1024
+
+struct json_parse_config {
+    /* Decode numbers into JT_INT, JT_UINT or JT_FLOAT. Numbers that overflow stay JT_NUMBER text. */
+    bool typed_numbers;
+    /* Allocate the result from this document's arena, release it with json_doc_free. */
+    struct json_doc_t *doc;
+    /*
+     * Leave strings and keys inside the input text, which must be writable
+     * and outlive the document: escapes are decoded and the closing quote
+     * becomes the terminator. Needs doc.
+     */
+    bool in_situ;
+    /* Reject objects and arrays nested deeper than this, 0 means JSON_MAX_DEPTH. */
+    size_t max_depth;
+    /* Receives the first syntax error, code is JSON_ERROR_NONE on success. */
+    struct json_error_t *error;
+    /*
+     * Parse an array or object root of at least JSON_PARALLEL_MIN bytes on
+     * this many threads, 0 or 1 parses on the calling thread. Ignored with
+     * doc or inside a document session, whose arena serves one thread only.
+     */
+    size_t threads;
+    /*
+     * Reject strings and keys that are not well-formed UTF-8, checked by the
+     * vector kernels as each string is lexed.
+     */
+    bool validate_utf8;
+};
+
+/* Smallest input split across threads */
+#define JSON_PARALLEL_MIN (1 << 20)
+
+#ifndef __cplusplus
+#define json_deserialize_with(text, ...) __json_deserialize_with((text), (struct json_parse_config){__VA_ARGS__})
+#define json_deserialize_n_with(text, len, ...) \
+    __json_deserialize_n_with((text), (len), (struct json_parse_config){__VA_ARGS__})
+#endif
+
+/* Members of the objects still open, each object's table is built once when it closes. */
+struct json_obj_members_t {
+    struct json_pair_t *pairs;
+    size_t length;
+    size_t capacity;
+};
+
+/*
+ * An open container of the iterative parser and, for objects, the key of the
+ * value being parsed and where its members start in the member buffer.
+ */
+struct json_parse_frame_t {
+    union json_t container;
+    char *key;
+    size_t first;
+};
+
 struct json_parser_context_t {
+    struct json_parse_config config;
     size_t token_index;
     struct json_lexer_context_t *lexer;
     union json_t root;
+    /*
+     * On-demand mode pulls each token from the lexer when a rule needs it
+     * instead of reading the token list, so json_execute_lexer is not called
+     * and no token list is built. Only one token of lookahead is kept.
+     */
+    bool on_demand;
+    bool has_lookahead;
+    struct json_lexer_token_t lookahead;
+    struct json_lexer_token_t current;
+    /* First error of the lexer or the grammar, root is JSON_MISSING if set */
+    struct json_error_t error;
+    /* Scratch buffer of the recursive rules, released by the parse */
+    struct json_obj_members_t members;
 };
 
 struct json_parser_context_t *json_create_parser(struct json_lexer_context_t *lexer);
 void json_delete_parser(struct json_parser_context_t *ctx);
+/*
+ * Parse with an explicit container stack, limited to config.max_depth levels.
+ * On a syntax error the partial tree is freed, root is JSON_MISSING and
+ * ctx->error holds the code and offset.
+ */
 void json_parse(struct json_parser_context_t *ctx);
+/* Parse with one C stack frame per nesting level and no depth limit. */
+void json_parse_recursive(struct json_parser_context_t *ctx);
 
+/* Return JSON_MISSING if the text is not valid JSON, see config.error for the reason. */
 union json_t json_deserialize(const char *input_text);
+union json_t __json_deserialize_with(const char *input_text, struct json_parse_config config);
+/* Parse input_text[0..len), which needs no terminator. */
+union json_t __json_deserialize_n_with(const char *input_text, size_t len, struct json_parse_config config);
 union json_t json_load(FILE *f);
+/* Parse a regular file from a read-only mapping, other files are read in chunks. */
 union json_t json_file(const char *file_path);
 // --------------------------------------------------
 //                  END JSON Parser
 // --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON Validator
+// --------------------------------------------------
+/*
+ * Check that buf[0..len) is one well-formed JSON value with valid UTF-8
+ * strings, without building a tree. buf needs no terminator. Return the
+ * first error, code is JSON_ERROR_NONE if the text is valid. Nesting is
+ * limited to JSON_MAX_DEPTH levels.
+ */
+struct json_error_t json_validate(const char *buf, size_t len);
+// --------------------------------------------------
+//                  END JSON Validator
+// --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON Stream
+// --------------------------------------------------
+/* Initial buffer size of a stream, and the read size of json_load */
+#define JSON_STREAM_CHUNK 16384
+
+/* Receives each completed value, which the callback owns. */
+typedef void (*json_stream_cb)(union json_t value, void *args);
+
+struct json_stream_config {
+    json_stream_cb callback;
+    void *args;
+    /*
+     * If the root is an array, emit its elements one by one as they
+     * complete instead of the whole root.
+     */
+    bool elements;
+    /*
+     * Accept any number of root values, concatenated or as an RFC 7464
+     * sequence, instead of exactly one.
+     */
+    bool sequence;
+    bool typed_numbers;
+    size_t max_depth;
+    bool validate_utf8;
+};
+
+#ifndef __cplusplus
+#define json_stream_new(...) __json_stream_new((struct json_stream_config){__VA_ARGS__})
+#endif
+
+/* What the stream accepts next */
+enum json_stream_state_t {
+    JSS_ROOT,        /* before a root value */
+    JSS_VALUE,       /* after ':' or after ',' in an array */
+    JSS_FIRST_VALUE, /* after '[' */
+    JSS_KEY,         /* after ',' in an object */
+    JSS_FIRST_KEY,   /* after '{' */
+    JSS_COLON,       /* after a key */
+    JSS_NEXT,        /* after a value inside a container */
+    JSS_DONE,        /* after the root value, only whitespace may follow */
+};
+
+/*
+ * Push parser for input that arrives in chunks. The parser's open containers
+ * are kept between chunks and grow as their members arrive, so each byte is
+ * lexed once and only a token cut by the end of a chunk is buffered. A value
+ * is emitted as soon as its last token is fed; a number or literal ends at
+ * the byte after it, or at json_stream_finish.
+ */
+struct json_stream_t {
+    struct json_stream_config config;
+    /* Unconsumed input, buf[0] is byte `offset` of the stream at row:column */
+    char *buf;
+    size_t len;
+    size_t capacity;
+    size_t offset;
+    size_t row;
+    size_t column;
+    /* Parser state, carried between chunks */
+    struct json_lexer_context_t lexer;
+    struct json_parser_context_t parser;
+    struct json_parse_frame_t *frames;
+    size_t depth;
+    size_t frames_capacity;
+    struct json_obj_members_t members;
+    enum json_stream_state_t state;
+    bool elements; /* inside the root array in elements mode, which has no frame */
+    size_t scan;   /* start of the next token in buf */
+    size_t string_scan; /* how far the body of a string cut by the chunk end was scanned, 0 if none */
+    /* First error, the stream stops there. Offsets count from the start of the stream. */
+    struct json_error_t error;
+};
+
+struct json_stream_t *__json_stream_new(struct json_stream_config config);
+void json_stream_free(struct json_stream_t *s);
+/* Feed the next chunk. Return the first error, JSON_ERROR_NONE while the input is fine so far. */
+enum json_error_code json_stream_feed(struct json_stream_t *s, const char *buf, size_t len);
+/* Signal the end of the input, which must have held exactly one root value, or any number in sequence mode. */
+enum json_error_code json_stream_finish(struct json_stream_t *s);
+// --------------------------------------------------
+//                  END JSON Stream
+// --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON Lines
+// --------------------------------------------------
+/* Bytes of input each worker takes at a time, extended to the end of a line */
+#define JSON_NDJSON_BATCH (1 << 20)
+
+/*
+ * One line of newline-delimited JSON. The value is JSON_MISSING if the line
+ * is not valid JSON, the error then holds its offset in the whole input and
+ * its line number in row.
+ */
+struct json_record_t {
+    union json_t value;
+    struct json_error_t error;
+};
+
+/* Receives the records in input order, the callback owns record->value. */
+typedef void (*json_ndjson_cb)(size_t index, struct json_record_t *record, void *args);
+
+struct json_ndjson_config {
+    size_t threads;    /* 0 for one per online CPU, 1 to parse on the calling thread */
+    size_t batch_size; /* 0 for JSON_NDJSON_BATCH */
+    bool typed_numbers;
+    size_t max_depth;
+    bool validate_utf8;
+    /* If set, records are passed here as they complete instead of being returned */
+    json_ndjson_cb callback;
+    void *args;
+};
+
+#ifndef __cplusplus
+#define json_ndjson_parse(buf, len, records, ...) \
+    __json_ndjson_parse((buf), (len), (records), (struct json_ndjson_config){__VA_ARGS__})
+#define json_ndjson_file(file_path, records, ...) \
+    __json_ndjson_file((file_path), (records), (struct json_ndjson_config){__VA_ARGS__})
+#endif
+
+/*
+ * Parse every non-blank line of buf[0..len) on a pool of threads. Lines may
+ * end in \n or \r\n. Without a callback, *records receives an array of the
+ * records in input order, free it with json_ndjson_free. The values are
+ * always allocated with malloc, even inside a document session. If memory
+ * runs out, the lines left unparsed are reported as one record with
+ * JSON_ERROR_NO_MEMORY at the first of them.
+ * Return the number of records.
+ */
+size_t __json_ndjson_parse(const char *buf, size_t len, struct json_record_t **records,
+                           struct json_ndjson_config config);
+/* Same for a file, which is mapped if it is a regular file and read whole otherwise. */
+size_t __json_ndjson_file(const char *file_path, struct json_record_t **records, struct json_ndjson_config config);
+void json_ndjson_free(struct json_record_t *records, size_t count);
+// --------------------------------------------------
+//                  END JSON Lines
+// --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON Sequence
+// --------------------------------------------------
+/* RFC 7464 record separator, starts every record of a JSON text sequence */
+#define JSON_RS '\x1e'
+
+/*
+ * Iterator over the top-level values of one buffer, either concatenated
+ * ({...}{...}[...], whitespace between values is optional where unambiguous)
+ * or as an RFC 7464 sequence if the first non-whitespace byte is JSON_RS.
+ * One lexer and parser are kept for the whole buffer, so every byte is
+ * scanned once.
+ */
+struct json_seq_t {
+    struct json_lexer_context_t lexer;
+    struct json_parser_context_t parser;
+    const char *buf;
+    size_t len;
+    /* RFC 7464: offset of the separator before the next record, len after the last one */
+    bool records;
+    size_t next_record;
+    /* Values returned so far */
+    size_t count;
+    /* Error of the last json_seq_next, row and column are counted from the known position */
+    struct json_error_t error;
+    size_t row;
+    size_t column;
+    size_t position;
+};
+
+#ifndef __cplusplus
+#define json_seq_new(buf, len, ...) __json_seq_new((buf), (len), (struct json_parse_config){__VA_ARGS__})
+#endif
+
+struct json_seq_t *__json_seq_new(const char *buf, size_t len, struct json_parse_config config);
+void json_seq_free(struct json_seq_t *seq);
+/*
+ * Store the next value in *value and return true. Return false at the end
+ * of the input or on an error, see seq->error. In an RFC 7464 sequence a
+ * bad record does not end the iteration: call again to resume at the next
+ * record separator.
+ */
+bool json_seq_next(struct json_seq_t *seq, union json_t *value);
+// --------------------------------------------------
+//                  END JSON Sequence
+// --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON Index
+// --------------------------------------------------
+#define JSON_INDEX_MAGIC "UJSONIDX"
+#define JSON_INDEX_VERSION 1
+
+/*
+ * Sidecar index file of a JSON file with an array or object root. The
+ * header is followed by count offsets, the offset of the comma or closing
+ * bracket after each member, then for objects by count hashes of the
+ * decoded keys. Values are stored in host byte order.
+ */
+struct json_index_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t is_obj;
+    /* The source as it was indexed */
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t checksum;
+    /* Offset of the opening bracket of the root */
+    uint64_t root;
+    uint64_t count;
+};
+
+/* A source file and its index, both mapped. Members are parsed on request. */
+struct json_index_t {
+    const char *source;
+    size_t source_len;
+    const struct json_index_header_t *header;
+    size_t index_len;
+    const uint64_t *ends;
+    const uint64_t *hashes; /* NULL for arrays */
+    size_t count;
+};
+
+#ifndef __cplusplus
+#define json_index_get(idx, i, ...) __json_index_get((idx), (i), (struct json_parse_config){__VA_ARGS__})
+#define json_index_get_key(idx, key, ...) __json_index_get_key((idx), (key), (struct json_parse_config){__VA_ARGS__})
+#endif
+
+/* Validate file_path and write its index to index_path. Return false if either file fails. */
+bool json_index_build(const char *file_path, const char *index_path);
+/*
+ * Map file_path and its index. Return NULL if the index does not match the
+ * size and modification time of the file, or with verify, its checksum.
+ * Only verify reads the whole file.
+ */
+struct json_index_t *json_index_open(const char *file_path, const char *index_path, bool verify);
+void json_index_close(struct json_index_t *idx);
+/* Parse only member i, the value for objects. JSON_MISSING if i is out of range. */
+union json_t __json_index_get(struct json_index_t *idx, size_t i, struct json_parse_config config);
+/* Parse only the value of key, the last one if the key repeats. JSON_MISSING if absent or the root is an array. */
+union json_t __json_index_get_key(struct json_index_t *idx, const char *key, struct json_parse_config config);
+// --------------------------------------------------
+//                  END JSON Index
+// --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON Pointer
+// --------------------------------------------------
+#ifndef __cplusplus
+#define json_deserialize_paths(text, len, paths, count, ...) \
+    __json_deserialize_paths((text), (len), (paths), (count), (struct json_parse_config){__VA_ARGS__})
+#endif
+
+/*
+ * Parse only the values at the given RFC 6901 JSON Pointers, e.g. "/users/0/name".
+ * The result keeps the shape of the document but holds only the selected
+ * values and the objects and arrays on the way to them. Array elements before
+ * a selected index are JSON_NULL so indexes stay the same, a path that does
+ * not exist is left out and "" selects the whole document. Every other value
+ * is skipped by counting brackets on the structural index, without allocating
+ * and without checking its syntax. JSON_MISSING if the root is not an array or
+ * object and "" is not given, or on a syntax error, see config.error.
+ */
+union json_t __json_deserialize_paths(const char *input_text, size_t len, const char *const *paths, size_t count,
+                                      struct json_parse_config config);
+// --------------------------------------------------
+//                  END JSON Pointer
+// --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON SAX
+// --------------------------------------------------
+/* Bytes of a mapped file read before they are dropped from memory, see json_sax_file */
+#define JSON_SAX_RELEASE (64 << 20)
+
+/*
+ * Events of a SAX parse, in document order. Any callback may be NULL. Text
+ * is decoded but not terminated and only valid during the call: it points
+ * into the input unless it had escapes. Numbers are passed as their text,
+ * which is a valid JSON number, see json_parse_double. A callback returns
+ * false to stop the parse with JSON_ERROR_ABORTED.
+ */
+struct json_sax_config {
+    bool (*start_object)(void *args);
+    bool (*end_object)(void *args);
+    bool (*start_array)(void *args);
+    bool (*end_array)(void *args);
+    bool (*key)(const char *key, size_t len, void *args);
+    bool (*string)(const char *str, size_t len, void *args);
+    bool (*number)(const char *text, size_t len, void *args);
+    bool (*boolean)(bool value, void *args);
+    bool (*null)(void *args);
+    void *args;
+    /* Reject objects and arrays nested deeper than this, 0 means JSON_MAX_DEPTH. */
+    size_t max_depth;
+    /* Stop with JSON_ERROR_INVALID_UTF8 at a string or key that is not well-formed UTF-8. */
+    bool validate_utf8;
+};
+
+#ifndef __cplusplus
+#define json_sax_parse(buf, len, ...) __json_sax_parse((buf), (len), (struct json_sax_config){__VA_ARGS__})
+#define json_sax_file(file_path, ...) __json_sax_file((file_path), (struct json_sax_config){__VA_ARGS__})
+#endif
+
+/*
+ * Report buf[0..len) to the callbacks as it is lexed, no tree is built.
+ * Events up to a syntax error have already been delivered when it is found.
+ */
+struct json_error_t __json_sax_parse(const char *buf, size_t len, struct json_sax_config config);
+/*
+ * Same over a file. Regular files are mapped and read pages are dropped as
+ * the parse moves on, so files larger than memory can be parsed. Other files
+ * are read whole. JSON_ERROR_IO if the file cannot be opened.
+ */
+struct json_error_t __json_sax_file(const char *file_path, struct json_sax_config config);
+// --------------------------------------------------
+//                  END JSON SAX
+// --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON Cursor
+// --------------------------------------------------
+/* An object or array the cursor has entered, or the root at depth 0. */
+struct json_cursor_frame_t {
+    size_t start; /* offset after the opening bracket */
+    bool is_obj;
+    bool first;   /* no member read yet */
+    bool pending; /* the current value has not been read */
+};
+
+/*
+ * Forward-only reader over one buffer that lexes just the tokens asked for
+ * and never builds a tree. The cursor starts on the root value: enter it,
+ * step through members with json_cursor_next or json_cursor_find, and read
+ * scalars with json_cursor_get_*. A value that is stepped over without
+ * being read is skipped by counting brackets on the structural index, so its
+ * syntax is not checked, nor is anything after the last value read.
+ */
+struct json_cursor_t {
+    struct json_lexer_context_t lexer;
+    struct json_parser_context_t parser;
+    struct json_cursor_frame_t *frames;
+    size_t depth;
+    size_t capacity;
+    /* Key token of the current member */
+    const char *key;
+    size_t key_len;
+    /* Decoded strings with escapes, valid until the next call */
+    char *scratch;
+    size_t scratch_len;
+    /* First syntax error, every call fails once it is set */
+    struct json_error_t error;
+};
+
+#ifndef __cplusplus
+#define json_cursor_new(buf, len, ...) __json_cursor_new((buf), (len), (struct json_parse_config){__VA_ARGS__})
+#endif
+
+/* config.max_depth limits json_cursor_enter_*, the rest applies to json_cursor_get_value. */
+struct json_cursor_t *__json_cursor_new(const char *buf, size_t len, struct json_parse_config config);
+void json_cursor_free(struct json_cursor_t *c);
+/* Type of the current value without reading it: JT_OBJECT, JT_ARRAY, JT_STRING, JT_NUMBER, JT_BOOL, JT_NULL, or JT_MISSING if there is none. */
+enum json_token_type_t json_cursor_type(struct json_cursor_t *c);
+/* Step into the current value, return false if it is not an object or array. */
+bool json_cursor_enter_object(struct json_cursor_t *c);
+bool json_cursor_enter_array(struct json_cursor_t *c);
+/*
+ * Move to the next member of the innermost object or array, skipping the
+ * current value if it was not read. At the end, step out of the container
+ * and return false.
+ */
+bool json_cursor_next(struct json_cursor_t *c);
+/* Key of the current object member, decoded and not terminated. */
+bool json_cursor_key(struct json_cursor_t *c, const char **key, size_t *len);
+/*
+ * Move to the member `key` of the innermost object. Members after the
+ * current one are searched first, then the ones before it. If the key is
+ * absent the cursor stays where it was.
+ */
+bool json_cursor_find(struct json_cursor_t *c, const char *key);
+/*
+ * Read the current value. Return false and leave it unread if it has another
+ * type or, for numbers, does not fit.
+ */
+bool json_cursor_get_i64(struct json_cursor_t *c, int64_t *out);
+bool json_cursor_get_u64(struct json_cursor_t *c, uint64_t *out);
+bool json_cursor_get_f64(struct json_cursor_t *c, double *out);
+bool json_cursor_get_bool(struct json_cursor_t *c, bool *out);
+bool json_cursor_get_null(struct json_cursor_t *c);
+/* The string is decoded and not terminated, it is valid until the next call. */
+bool json_cursor_get_str(struct json_cursor_t *c, const char **str, size_t *len);
+/* Build the current value as a tree, with the config given to json_cursor_new. */
+bool json_cursor_get_value(struct json_cursor_t *c, union json_t *out);
+// --------------------------------------------------
+//                  END JSON Cursor
+// --------------------------------------------------
+
+// --------------------------------------------------
+//                  JSON Document
+// --------------------------------------------------
+struct json_arena_chunk_t;
+
+/* Bump allocator, chunks double in size up to 1 MiB. */
+struct json_arena_t {
+    struct json_arena_chunk_t *chunks;
+    char *ptr;
+    char *end;
+    size_t next_size;
+};
+
+/*
+ * A document owns the memory of its tree. Everything the library allocates
+ * on this thread between json_doc_begin and json_doc_end comes from the
+ * arena, so json_doc_free releases the tree at once. Only modify the tree
+ * inside such a session and never json_clean it outside one.
+ */
+struct json_doc_t {
+    union json_t root;
+    struct json_arena_t arena;
+    struct json_doc_t *outer; /* document active before json_doc_begin */
+    /* Private mapping of the file the tree points into, see json_doc_file */
+    char *map;
+    size_t map_len;
+};
+
+struct json_doc_t *json_doc_new(void);
+void json_doc_free(struct json_doc_t *doc);
+void json_doc_begin(struct json_doc_t *doc);
+void json_doc_end(struct json_doc_t *doc);
+/*
+ * Detach the document active on this thread and return it, so the library
+ * allocates with malloc until __json_doc_resume reattaches it.
+ */
+struct json_doc_t *__json_doc_suspend(void);
+void __json_doc_resume(struct json_doc_t *doc);
+struct json_doc_t *json_doc_deserialize(const char *input_text);
+struct json_doc_t *json_doc_deserialize_in_situ(char *buffer);
+/*
+ * Parse a file in situ from a private copy-on-write mapping, so strings and
+ * keys point into the mapping and the file itself is never modified or read
+ * into a buffer. Only pages holding strings get copied, when their closing
+ * quote becomes a terminator. Files that cannot be mapped are read instead.
+ * Return NULL if the file cannot be opened.
+ */
+struct json_doc_t *json_doc_file(const char *file_path);
+// --------------------------------------------------
+//                  END JSON Document
+// --------------------------------------------------
 #endif /* __JSON_H__ */
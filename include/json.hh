@@ -13,6 +13,19 @@ extern "C" {
 #define json_dumps(j, ...) __json_dumps((j), {__VA_ARGS__})
 #define json_dump(j, f, ...) __json_dump((j), (f), {__VA_ARGS__})
 #define json_pprint(j, ...) __json_pprint((j), {__VA_ARGS__})
+#define json_deserialize_with(text, ...) __json_deserialize_with((text), {__VA_ARGS__})
+#define json_deserialize_n_with(text, len, ...) __json_deserialize_n_with((text), (len), {__VA_ARGS__})
+#define json_stream_new(...) __json_stream_new({__VA_ARGS__})
+#define json_seq_new(buf, len, ...) __json_seq_new((buf), (len), {__VA_ARGS__})
+#define json_index_get(idx, i, ...) __json_index_get((idx), (i), {__VA_ARGS__})
+#define json_index_get_key(idx, key, ...) __json_index_get_key((idx), (key), {__VA_ARGS__})
+#define json_deserialize_paths(text, len, paths, count, ...) \
+    __json_deserialize_paths((text), (len), (paths), (count), {__VA_ARGS__})
+#define json_sax_parse(buf, len, ...) __json_sax_parse((buf), (len), {__VA_ARGS__})
+#define json_sax_file(file_path, ...) __json_sax_file((file_path), {__VA_ARGS__})
+#define json_cursor_new(buf, len, ...) __json_cursor_new((buf), (len), {__VA_ARGS__})
+#define json_ndjson_parse(buf, len, records, ...) __json_ndjson_parse((buf), (len), (records), {__VA_ARGS__})
+#define json_ndjson_file(file_path, records, ...) __json_ndjson_file((file_path), (records), {__VA_ARGS__})
 
 constexpr union json_t JSON_MISSING = {.type = JT_MISSING};
 constexpr union json_t JSON_DELETE = {.type = JT_MISSING};
@@ -5,52 +5,9 @@
 // #include "jsonEditor.h"
 // #include "jsonLexer.h"
 // #include "jsonParser.h"
-// #include "jsonListener.h"
 // #include "jsonParser.h"
 #include <json.h>
 
-// void enterJson(struct WalkerContext *ctx, struct jsonToken *token) {
-// }
-
-// void exitJson(struct WalkerContext *ctx, struct jsonToken *token) {
-// }
-
-// void enterObj(struct WalkerContext *ctx, json_obj_t *token) {
-// }
-
-// void exitObj(struct WalkerContext *ctx, json_obj_t *token) {
-// }
-
-// void enterArr(struct WalkerContext *ctx, struct arrToken *token) {
-// }
-
-// void exitArr(struct WalkerContext *ctx, struct arrToken *token) {
-// }
-
-// void enterValue(struct WalkerContext *ctx, json_t *token) {
-// }
-
-// void exitValue(struct WalkerContext *ctx, json_t *token) {
-// }
-
-// void enterPair(struct WalkerContext *ctx, struct pairToken *token) {
-// }
-
-// void exitPair(struct WalkerContext *ctx, struct pairToken *token) {
-//     if (token->value.next.type != ARR && token->value.next.type != OBJ) {
-//         printf("%u:%u ", token->key.column, token->key.row);
-
-//         for (int i = 0; i < ctx->pathLength; i++) {
-//             if (ctx->path[i]->type == PAIR) {
-//                 struct pairToken *pair = (struct pairToken *)ctx->path[i];
-//                 printf(".%s", pair->key.text);
-//             }
-//         }
-
-//         printf(" = %s\n", token->value.anyToken.text);
-//     }
-// }
-
 void obj_test() {
 
     JSON_CURRENT_LOG_LEVEL = JSON_LOG_LEVEL_ERROR;
@@ -22,15 +22,15 @@ size_t my_array_capacity(struct my_array *m) {
 }
 
 void my_array_free(struct my_array *m) {
-    if (m) free(m->data);
-    free(m);
+    if (m) json_free(m->data);
+    json_free(m);
 }
 
 struct my_array *my_array_new(size_t capacity) {
-    struct my_array *m = (struct my_array *)malloc(sizeof(struct my_array));
+    struct my_array *m = (struct my_array *)json_malloc(sizeof(struct my_array));
     if (!m) return NULL;
 
-    m->data = (union json_t **)calloc(capacity, sizeof(union json_t *));
+    m->data = (union json_t **)json_calloc(capacity, sizeof(union json_t *));
     if (!m->data) {
         my_array_free(m);
         return NULL;
@@ -49,7 +49,7 @@ bool my_array_expand(struct my_array *m, size_t new_size) {
     if (m->length > new_size) return false;
 
     /* Setup the new elements */
-    union json_t **temp = (union json_t **)calloc(new_size, sizeof(union json_t *));
+    union json_t **temp = (union json_t **)json_calloc(new_size, sizeof(union json_t *));
     if (!temp) return false;
 
     curr = m->data;
@@ -59,7 +59,7 @@ bool my_array_expand(struct my_array *m, size_t new_size) {
 
     memcpy(m->data, curr, m->length * sizeof(union json_t *));
 
-    free(curr);
+    json_free(curr);
 
     return temp;
 }
@@ -1,4 +1,13 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+// madvise, posix_madvise ignores POSIX_MADV_DONTNEED on glibc
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
 #include <assert.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -7,9 +16,16 @@
 #include <time.h>
 
 #include "json.h"
+#include "json_float.h"
+#include "json_simd.h"
 
 #include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define UNUSED(x) ((void)(x))
 
@@ -65,7 +81,7 @@ void json_print_trace(void) {
 
 char *json_strdup(const char *s) {
     size_t size = strlen(s) + 1;
-    char *p = (char *)malloc(size);
+    char *p = (char *)json_malloc(size);
     if (p != NULL) {
         memcpy(p, s, size);
     }
@@ -78,7 +94,7 @@ char *json_strndup(const char *s, size_t n) {
 
     for (n1 = 0; n1 < n && s[n1] != '\0'; n1++)
         continue;
-    p = (char *)malloc(n + 1);
+    p = (char *)json_malloc(n + 1);
     if (p != NULL) {
         memcpy(p, s, n1);
         p[n1] = '\0';
@@ -86,6 +102,72 @@ char *json_strndup(const char *s, size_t n) {
     return p;
 }
 
+// --------------------------------------------------
+// SECTION: JSON Memory
+// --------------------------------------------------
+
+#define JSON_ARENA_MIN_CHUNK 4096
+#define JSON_ARENA_MAX_CHUNK (1 << 20)
+
+struct json_arena_chunk_t {
+    struct json_arena_chunk_t *next;
+    max_align_t data[];
+};
+
+/* Document whose arena serves json_malloc on this thread, NULL for the heap. */
+static __thread struct json_doc_t *active_doc = NULL;
+
+static void *arena_alloc(struct json_arena_t *arena, size_t size) {
+    const size_t align = __alignof__(max_align_t);
+
+    size = (size + align - 1) & ~(align - 1);
+    if ((size_t)(arena->end - arena->ptr) < size) {
+        size_t chunk_size = arena->next_size ? arena->next_size : JSON_ARENA_MIN_CHUNK;
+        if (chunk_size < size)
+            chunk_size = size;
+
+        struct json_arena_chunk_t *chunk =
+            (struct json_arena_chunk_t *)malloc(sizeof(struct json_arena_chunk_t) + chunk_size);
+        if (!chunk)
+            return NULL;
+
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->ptr = (char *)chunk->data;
+        arena->end = arena->ptr + chunk_size;
+        if (chunk_size < JSON_ARENA_MAX_CHUNK)
+            arena->next_size = chunk_size * 2;
+    }
+
+    void *p = arena->ptr;
+    arena->ptr += size;
+    return p;
+}
+
+void *json_malloc(size_t size) {
+    return active_doc ? arena_alloc(&active_doc->arena, size) : malloc(size);
+}
+
+void *json_calloc(size_t count, size_t size) {
+    if (!active_doc)
+        return calloc(count, size);
+
+    void *p = arena_alloc(&active_doc->arena, count * size);
+    if (p)
+        memset(p, 0, count * size);
+    return p;
+}
+
+void json_free(void *ptr) {
+    // arena memory is released with its document
+    if (!active_doc)
+        free(ptr);
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Memory
+// --------------------------------------------------
+
 // --------------------------------------------------
 // SECTION: JSON TOKEN
 // --------------------------------------------------
@@ -198,7 +280,8 @@ static void sb_init(struct sb *sb) {
 // Ensure there is enough capacity to append additional bytes.
 static void sb_ensure_capacity(struct sb *sb, size_t additional) {
     if (sb->length + additional + 1 > sb->capacity) {
-        sb->capacity *= 2;
+        while (sb->length + additional + 1 > sb->capacity)
+            sb->capacity *= 2;
         char *new_data = (char *)realloc(sb->data, sb->capacity);
         if (!new_data) {
             free(sb->data);
@@ -209,15 +292,17 @@ static void sb_ensure_capacity(struct sb *sb, size_t additional) {
     }
 }
 
-// Append a C-string to the string builder.
-static void sb_append(struct sb *sb, const char *str) {
-    size_t len = strlen(str);
+// Append len bytes of str to the string builder.
+static void sb_append_n(struct sb *sb, const char *str, size_t len) {
     sb_ensure_capacity(sb, len);
     memcpy(sb->data + sb->length, str, len);
     sb->length += len;
     sb->data[sb->length] = '\0';
 }
 
+// Append a C-string to the string builder.
+static void sb_append(struct sb *sb, const char *str) { sb_append_n(sb, str, strlen(str)); }
+
 // Append a single character to the string builder.
 static void sb_append_char(struct sb *sb, char c) {
     sb_ensure_capacity(sb, 1);
@@ -244,6 +329,45 @@ static void sb_appendf(struct sb *sb, const char *fmt, ...) {
     va_end(args);
 }
 
+/*
+ * Return the escape sequence of c inside a JSON string, or NULL if c is
+ * written as is. Control characters without a short form use buf.
+ */
+static const char *escape_char(unsigned char c, char buf[7]) {
+    switch (c) {
+    case '"': return "\\\"";
+    case '\\': return "\\\\";
+    case '\b': return "\\b";
+    case '\f': return "\\f";
+    case '\n': return "\\n";
+    case '\r': return "\\r";
+    case '\t': return "\\t";
+    default:
+        if (c >= 0x20)
+            return NULL;
+        snprintf(buf, 7, "\\u%04x", c);
+        return buf;
+    }
+}
+
+// Append str as a quoted JSON string to the string builder.
+static void sb_append_quoted(struct sb *sb, const char *str) {
+    const char *run = str;
+    char buf[7];
+
+    sb_append_char(sb, '"');
+    for (; *str; str++) {
+        const char *esc = escape_char((unsigned char)*str, buf);
+        if (esc) {
+            sb_append_n(sb, run, str - run);
+            sb_append(sb, esc);
+            run = str + 1;
+        }
+    }
+    sb_append_n(sb, run, str - run);
+    sb_append_char(sb, '"');
+}
+
 // Append indentation (spaces) to the string builder.
 static void sb_append_indent(struct sb *sb, int indent) {
     for (int i = 0; i < indent; i++) {
@@ -262,7 +386,7 @@ static void sb_append_crlf(struct sb *sb, int indent) {
 static void json_dumps_internal(union json_t j, int offset, int indent, struct sb *sb) {
     switch (j.type) {
     case JT_STRING:
-        sb_appendf(sb, "\"%s\"", j.text);
+        sb_append_quoted(sb, j.text);
         break;
     case JT_NUMBER:
         sb_appendf(sb, "%s", j.text);
@@ -310,7 +434,8 @@ static void json_dumps_internal(union json_t j, int offset, int indent, struct s
             struct json_pair_t *it = jsonext_obj_iter_first(&j);
             while (it != NULL) {
                 sb_append_indent(sb, offset + indent);
-                sb_appendf(sb, "\"%s\": ", it->key);
+                sb_append_quoted(sb, it->key);
+                sb_append(sb, ": ");
                 json_dumps_internal(it->value, offset + indent, indent, sb);
                 it = jsonext_obj_iter_next(&j, it);
                 if (it != NULL) {
@@ -357,6 +482,24 @@ static void print_indent(FILE *fp, int indent) {
     }
 }
 
+// Helper function to print str as a quoted JSON string.
+static void print_quoted(FILE *fp, const char *str) {
+    const char *run = str;
+    char buf[7];
+
+    fputc('"', fp);
+    for (; *str; str++) {
+        const char *esc = escape_char((unsigned char)*str, buf);
+        if (esc) {
+            fwrite(run, 1, str - run, fp);
+            fputs(esc, fp);
+            run = str + 1;
+        }
+    }
+    fwrite(run, 1, str - run, fp);
+    fputc('"', fp);
+}
+
 // Helper function to print a newline if the indent value is non-negative.
 static void print_crlf(FILE *fp, int diff) {
     if (diff >= 0)
@@ -368,7 +511,7 @@ static void print_crlf(FILE *fp, int diff) {
 static void json_print_internal(union json_t j, int offset, int indent, FILE *fp) {
     switch (j.type) {
     case JT_STRING:
-        fprintf(fp, "\"%s\"", j.text);
+        print_quoted(fp, j.text);
         break;
     case JT_NUMBER:
         fprintf(fp, "%s", j.text);
@@ -415,7 +558,8 @@ static void json_print_internal(union json_t j, int offset, int indent, FILE *fp
             struct json_pair_t *it = jsonext_obj_iter_first(&j);
             while (it != NULL) {
                 print_indent(fp, offset + indent);
-                fprintf(fp, "\"%s\": ", it->key);
+                print_quoted(fp, it->key);
+                fprintf(fp, ": ");
                 json_print_internal(it->value, offset + indent, indent, fp);
                 it = jsonext_obj_iter_next(&j, it);
                 if (it != NULL) {
@@ -456,7 +600,7 @@ void json_clean(union json_t *j) {
     case JT_BOOL:
     case JT_NULL:
     case JT_FLOAT: {
-        free(j->text);
+        json_free(j->text);
         j->text = NULL;
         break;
     }
@@ -618,8 +762,8 @@ union json_t __json_remove_from_obj(union json_t *j, const char *key) {
         return res;
     if (p) {
         res = p->value;
-        free(p->key);
-        free(p);
+        json_free(p->key);
+        json_free(p);
     }
     return res;
 }
@@ -631,31 +775,74 @@ void __json_delete_from_obj(union json_t *j, const char *key) {
     json_clean(&rm);
 }
 
-bool __json_set_obj(union json_t *j, const char *key, size_t key_len, union json_t value, bool copy_value) {
-    if (!j || j->type != JT_OBJECT)
-        return false;
-
-    if (value.type == JT_MISSING) {
-        __json_delete_from_obj(j, key);
-        return true;
-    }
-
+/* Insert value under key, taking ownership of both. key is a json_malloc'd or document string. */
+static void obj_put(union json_t *j, char *key, union json_t value) {
     union json_t *exist_value = __json_getp_from_obj(*j, key);
 
     if (exist_value) {
         JSON_LOG_INFO("Set Object Key Exist: key=%s", key);
+        json_free(key);
         json_clean(exist_value);
-        *exist_value = copy_value ? json_dup(value) : value;
-        return true;
+        *exist_value = value;
+        return;
     }
 
-    struct json_pair_t *new_pair = (struct json_pair_t *)malloc(sizeof(struct json_pair_t));
-    new_pair->key = json_strndup(key, key_len);
-    new_pair->value = copy_value ? json_dup(value) : value;
+    struct json_pair_t *new_pair = (struct json_pair_t *)json_malloc(sizeof(struct json_pair_t));
+    new_pair->key = key;
+    new_pair->value = value;
 
     JSON_LOG_INFO("Set Object: key=%s value=<%d|%s> ", key, value.type, json_type2str(value.type));
     jsonext_obj_insert(j, new_pair);
+}
+
+/*
+ * Same as obj_put, but one probe both finds a duplicate key and places a new
+ * one. Return false, releasing key and value, if memory ran out.
+ */
+static bool obj_emplace(union json_t *j, char *key, union json_t value) {
+    struct json_pair_t *pair = (struct json_pair_t *)json_malloc(sizeof(struct json_pair_t));
+    struct json_pair_t *exist;
+
+    if (!pair) {
+        JSON_LOG_ERROR("Memory allocation failed");
+        json_free(key);
+        json_clean(&value);
+        return false;
+    }
+
+    pair->key = key;
+    pair->value = value;
+    exist = jsonext_obj_emplace(j, pair);
+    if (exist == pair)
+        return true;
+
+    if (exist) {
+        JSON_LOG_INFO("Set Object Key Exist: key=%s", key);
+        json_clean(&exist->value);
+        exist->value = value;
+    } else {
+        JSON_LOG_ERROR("Memory allocation failed");
+        json_clean(&pair->value);
+    }
+    json_free(key);
+    json_free(pair);
+    return exist != NULL;
+}
+
+bool __json_set_obj(union json_t *j, const char *key, size_t key_len, union json_t value, bool copy_value) {
+    if (!j || j->type != JT_OBJECT)
+        return false;
+
+    // key may point into a larger buffer, look up the terminated copy
+    char *new_key = json_strndup(key, key_len);
 
+    if (value.type == JT_MISSING) {
+        __json_delete_from_obj(j, new_key);
+        json_free(new_key);
+        return true;
+    }
+
+    obj_put(j, new_key, copy_value ? json_dup(value) : value);
     return true;
 }
 bool json_set_obj_str(union json_t *j, const char *key, const char *value) {
@@ -762,7 +949,7 @@ union json_t __json_remove_from_arr(union json_t *j, long int i) {
         return res;
     if (it) {
         res = *it;
-        free(it);
+        json_free(it);
     }
     return res;
 }
@@ -857,7 +1044,7 @@ bool __json_append(union json_t *j, union json_t value, bool copy_value) {
     if (!j || j->type != JT_ARRAY || value.type == JT_MISSING)
         return false;
 
-    union json_t *new_value = (union json_t *)malloc(sizeof(union json_t));
+    union json_t *new_value = (union json_t *)json_malloc(sizeof(union json_t));
     *new_value = copy_value ? json_dup(value) : value;
 
     jsonext_arr_append(j, new_value);
@@ -891,6 +1078,37 @@ bool json_append_value_p(union json_t *j, union json_t *value) {
 // !SECTION: END JSON ARRAY FUNCTION
 // --------------------------------------------------
 
+// --------------------------------------------------
+// SECTION: JSON Error
+// --------------------------------------------------
+
+static const char *error_str[] = {
+    "no error",          "invalid character", "invalid literal", "invalid number",
+    "invalid string",    "invalid escape",    "unexpected token", "unexpected end of input",
+    "trailing data",     "nesting too deep",  "invalid UTF-8",    "out of memory",
+    "aborted by callback", "could not read input",
+};
+
+const char *json_error2str(enum json_error_code code) {
+    if (code >= JSON_ERROR_NONE && code < JSON_ERROR_CODE_SIZE) {
+        return error_str[code];
+    }
+
+    return NULL;
+}
+
+/* Keep the first error only, later ones are consequences of it. */
+static void set_error(struct json_error_t *error, enum json_error_code code, size_t offset) {
+    if (error->code == JSON_ERROR_NONE) {
+        error->code = code;
+        error->offset = offset;
+    }
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Error
+// --------------------------------------------------
+
 // --------------------------------------------------
 // SECTION: JSON Lexer
 // --------------------------------------------------
@@ -909,32 +1127,127 @@ const char *json_lexer_type2str(enum json_lexer_token_type_t type) {
     return NULL;
 }
 
-struct json_lexer_context_t *json_create_lexer(const char *str) {
-    struct json_lexer_context_t *ctx_p = (struct json_lexer_context_t *)malloc(sizeof(struct json_lexer_context_t));
-
+static void init_lexer(struct json_lexer_context_t *ctx_p, const char *str, size_t len) {
     struct json_lexer_context_t ctx = {
         .tokens =
             {
                 .length = 0,
                 .capacity = 0,
                 .list = NULL,
+                .lengths = NULL,
             },
         .offset = 0,
-        .column = 1,
-        .row = 1,
         .from_string = str,
-        .from_string_len = strlen(str),
+        .from_string_len = len,
+        .stage1 = {0},
+        .structurals = 0,
+        .structurals_base = 0,
+        .stage1_offset = 0,
+        .index = NULL,
+        .validate_utf8 = false,
+        .error = {.code = JSON_ERROR_NONE},
+        .line_starts = NULL,
+        .line_count = 0,
+        .line_capacity = 0,
+        .lines_scanned = 0,
     };
 
     *ctx_p = ctx;
+}
+
+/* Restart at offset `start` of the same input, which now ends at `end`. */
+static void seek_lexer(struct json_lexer_context_t *ctx, size_t start, size_t end) {
+    // a precomputed index is only read whole blocks at a time
+    size_t block = ctx->index ? start - start % JSON_BLOCK_SIZE : start;
+
+    ctx->offset = start;
+    ctx->from_string_len = end;
+    ctx->stage1 = (struct json_stage1_t){0};
+    ctx->structurals = 0;
+    ctx->structurals_base = block;
+    ctx->stage1_offset = block;
+    ctx->error = (struct json_error_t){.code = JSON_ERROR_NONE};
+}
+
+struct json_lexer_context_t *json_create_lexer(const char *str) {
+    struct json_lexer_context_t *ctx_p = (struct json_lexer_context_t *)malloc(sizeof(struct json_lexer_context_t));
+
+    init_lexer(ctx_p, str, strlen(str));
 
     return ctx_p;
 }
 
+/*
+ * Advance a row/column position from offset `from` to offset `to`: every
+ * byte is one column and '\n' starts a new row. Only the newlines are
+ * visited, memchr jumps over the bytes between them.
+ */
+static void advance_position(const char *str, size_t from, size_t to, size_t *row, size_t *column) {
+    const char *p = str + from, *end = str + to, *nl;
+
+    while (p < end && (nl = (const char *)memchr(p, '\n', end - p))) {
+        (*row)++;
+        *column = 1;
+        p = nl + 1;
+    }
+    *column += end - p;
+}
+
+void json_lexer_position(struct json_lexer_context_t *ctx, size_t offset, size_t *row, size_t *column) {
+    size_t lo = 0, hi;
+
+    if (offset > ctx->from_string_len)
+        offset = ctx->from_string_len;
+
+    // index the line starts up to offset, each byte is searched once per lexer
+    while (ctx->lines_scanned < offset) {
+        const char *p = ctx->from_string + ctx->lines_scanned;
+        const char *nl = (const char *)memchr(p, '\n', offset - ctx->lines_scanned);
+
+        if (!nl) {
+            ctx->lines_scanned = offset;
+            break;
+        }
+
+        if (ctx->line_count == ctx->line_capacity) {
+            size_t capacity = ctx->line_capacity ? 2 * ctx->line_capacity : 64;
+            size_t *grown = (size_t *)realloc(ctx->line_starts, capacity * sizeof(size_t));
+            if (!grown) {
+                // count from the start instead, without the index
+                *row = 1;
+                *column = 1;
+                advance_position(ctx->from_string, 0, offset, row, column);
+                return;
+            }
+            ctx->line_starts = grown;
+            ctx->line_capacity = capacity;
+        }
+
+        ctx->line_starts[ctx->line_count++] = nl - ctx->from_string + 1;
+        ctx->lines_scanned = nl - ctx->from_string + 1;
+    }
+
+    // number of rows that start at or before offset, after the first
+    hi = ctx->line_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ctx->line_starts[mid] <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *row = lo + 1;
+    *column = offset - (lo ? ctx->line_starts[lo - 1] : 0) + 1;
+}
+
 void json_print_lexer(struct json_lexer_context_t *ctx) {
     struct json_lexer_token_t t;
+
     for (size_t i = 0; i < ctx->tokens.length; i++) {
-        t = ctx->tokens.list[i];
+        // the line index makes the position of every token a binary search
+        t = json_lexer_token_at(ctx, i);
+
         printf("@%lu#%lu,%lu<%u|%s>%lu:%lu", t.index, t.start, t.end, t.type, json_lexer_type2str(t.type), t.row,
                t.column);
 
@@ -948,11 +1261,56 @@ void json_print_lexer(struct json_lexer_context_t *ctx) {
 }
 
 void json_delete_lexer(struct json_lexer_context_t *ctx) {
-    if (ctx && ctx->tokens.list)
+    if (ctx) {
         free(ctx->tokens.list);
+        free(ctx->tokens.lengths);
+        free(ctx->line_starts);
+    }
     free(ctx);
 }
 
+/* Byte classes of the scalar lexer, found with one table load per byte */
+enum json_char_class_t {
+    JCC_INVALID,
+    JCC_SPACE,    /* ' ' '\t' '\r' '\n' */
+    JCC_LPAIR,
+    JCC_RPAIR,
+    JCC_LARRAY,
+    JCC_RARRAY,
+    JCC_COMMA,
+    JCC_COLON,
+    JCC_QUOTE,
+    JCC_NUMBER,   /* digits, '-', '+' and '.', which start and continue a number */
+    JCC_EXPONENT, /* 'e' and 'E', which only continue one */
+    JCC_TRUE,     /* 't' */
+    JCC_FALSE,    /* 'f' */
+    JCC_NULL,     /* 'n' */
+};
+
+static const uint8_t char_class[256] = {
+    /* 0x00 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID,
+    /* 0x08 */ JCC_INVALID, JCC_SPACE, JCC_SPACE, JCC_INVALID, JCC_INVALID, JCC_SPACE, JCC_INVALID, JCC_INVALID,
+    /* 0x10 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID,
+    /* 0x18 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID,
+    /* 0x20 */ JCC_SPACE, JCC_INVALID, JCC_QUOTE, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID,
+    /* 0x28 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_NUMBER, JCC_COMMA, JCC_NUMBER, JCC_NUMBER, JCC_INVALID,
+    /* 0x30 */ JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER,
+    /* 0x38 */ JCC_NUMBER, JCC_NUMBER, JCC_COLON, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID,
+    /* 0x40 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_EXPONENT, JCC_INVALID, JCC_INVALID,
+    /* 0x48 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID,
+    /* 0x50 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID,
+    /* 0x58 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_LARRAY, JCC_INVALID, JCC_RARRAY, JCC_INVALID, JCC_INVALID,
+    /* 0x60 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_EXPONENT, JCC_FALSE, JCC_INVALID,
+    /* 0x68 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_NULL, JCC_INVALID,
+    /* 0x70 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_TRUE, JCC_INVALID, JCC_INVALID, JCC_INVALID,
+    /* 0x78 */ JCC_INVALID, JCC_INVALID, JCC_INVALID, JCC_LPAIR, JCC_INVALID, JCC_RPAIR, JCC_INVALID, JCC_INVALID,
+    // 0x80 and up only occur inside strings
+};
+
+static enum json_char_class_t class_at(const struct json_lexer_context_t *ctx, size_t offset) {
+    return (enum json_char_class_t)char_class[(unsigned char)ctx->from_string[offset]];
+}
+
 /*
  * The comment block below explains the role of the offset:
  *
@@ -966,6 +1324,15 @@ void json_delete_lexer(struct json_lexer_context_t *ctx) {
  *        Last Matched |  Lookahead
  *                     Offset
 */
+static int lookahead_char(struct json_lexer_context_t *ctx) {
+    if (ctx->offset >= ctx->from_string_len) {
+        return EOF;
+    }
+
+    // unsigned, a 0xFF byte must not read as EOF
+    return (unsigned char)ctx->from_string[ctx->offset];
+}
+
 static int next_char(struct json_lexer_context_t *ctx) {
     if (!ctx->from_string) {
         JSON_LOG_ERROR("No input string provided");
@@ -978,17 +1345,20 @@ static int next_char(struct json_lexer_context_t *ctx) {
     }
 
     ctx->offset++;
-    ctx->column++;
 
-    return ctx->from_string[ctx->offset];
+    // the input need not be terminated, see __json_deserialize_n_with
+    return lookahead_char(ctx);
 }
 
-static int lookahead_char(struct json_lexer_context_t *ctx) {
-    if (ctx->offset >= ctx->from_string_len) {
-        return EOF;
-    }
-
-    return ctx->from_string[ctx->offset];
+/*
+ * Record an error at the current offset and stop: the lexer jumps to the end
+ * of the input, so every later lookahead is EOF and no more blocks are indexed.
+ */
+static void lexer_error(struct json_lexer_context_t *ctx, enum json_error_code code) {
+    set_error(&ctx->error, code, ctx->offset);
+    ctx->offset = ctx->from_string_len;
+    ctx->structurals = 0;
+    ctx->stage1_offset = ctx->from_string_len;
 }
 
 static bool lookahead(struct json_lexer_context_t *ctx, int c) { return lookahead_char(ctx) == c; }
@@ -996,38 +1366,24 @@ static bool lookahead(struct json_lexer_context_t *ctx, int c) { return lookahea
 static void match(struct json_lexer_context_t *ctx, int c) {
     int cur = lookahead_char(ctx);
 
-    // always get the next one before checking
-    next_char(ctx);
-
     if (cur != c) {
-        JSON_LOG_ERROR("Syntax Error %lu:%lu: Expected Char: %c (%d) But currect char is %c (%d)", ctx->row, ctx->column,
-                       c, c, cur, cur);
-        json_print_trace();
-        assert(0);
+        lexer_error(ctx, cur == EOF ? JSON_ERROR_UNEXPECTED_EOF : JSON_ERROR_INVALID_CHAR);
+        return;
     }
+
+    next_char(ctx);
 }
 
+/* Match the literal `true`, `false` or `null` as a whole. */
 static void match_str(struct json_lexer_context_t *ctx, const char *str) {
-    for (int i = 0; str[i] != '\0'; i++) {
-        match(ctx, str[i]);
-    }
-}
+    size_t len = strlen(str);
 
-static bool match_if_exist(struct json_lexer_context_t *ctx, int c) {
-    if (lookahead(ctx, c)) {
-        match(ctx, c);
-        return true;
+    if (ctx->from_string_len - ctx->offset < len || memcmp(ctx->from_string + ctx->offset, str, len) != 0) {
+        lexer_error(ctx, JSON_ERROR_INVALID_LITERAL);
+        return;
     }
-    return false;
-}
 
-static bool match_between_if_exist(struct json_lexer_context_t *ctx, int start, int end) {
-    int cur = lookahead_char(ctx);
-    if (cur >= start && cur <= end) {
-        match(ctx, cur);
-        return true;
-    }
-    return false;
+    ctx->offset += len;
 }
 
 static const char *substring(struct json_lexer_context_t *ctx, size_t start, size_t end) {
@@ -1036,10 +1392,6 @@ static const char *substring(struct json_lexer_context_t *ctx, size_t start, siz
 
 static void insert_token(struct json_lexer_context_t *ctx, struct json_lexer_token_t *t) {
     struct json_lexer_container_t *tokens = &ctx->tokens;
-    struct json_lexer_token_t *oldList = NULL;
-    struct json_lexer_token_t *newList = NULL;
-    size_t oldSize = 0;
-    size_t newSize = 0;
 
     if (!tokens) {
         JSON_LOG_ERROR("Error Token Container is not initialized");
@@ -1047,321 +1399,484 @@ static void insert_token(struct json_lexer_context_t *ctx, struct json_lexer_tok
         assert(0);
     }
 
-    // If the token list is not yet allocated, initialize it with a capacity of 1.
-    if (!tokens->list) {
-        tokens->capacity = 1;
-        tokens->list = (struct json_lexer_token_t *)malloc(sizeof(struct json_lexer_token_t) * tokens->capacity);
-    }
-
-    // If the token list is full, double its capacity.
+    // If the token list is full, double its capacity, starting from 1.
     // This operation involves:
-    // 1. Calculating the size of the old list.
-    // 2. Allocating a new list with double the capacity.
-    // 3. Copying the old tokens into the new list.
-    // 4. Freeing the old list.
+    // 1. Allocating a new list and a new length array with double the capacity.
+    // 2. Copying the old tokens and lengths into them.
+    // 3. Freeing the old ones.
+    // If either allocation fails the container is left as it was and lexing stops.
     if (tokens->length >= tokens->capacity) {
-        oldSize = sizeof(struct json_lexer_token_t) * tokens->capacity;
-        oldList = tokens->list;
-        newSize = sizeof(struct json_lexer_token_t) * tokens->capacity * 2;
-        newList = (struct json_lexer_token_t *)malloc(newSize);
-
-        memcpy(newList, oldList, oldSize);
-        free(oldList);
-        oldList = NULL;
+        size_t capacity = tokens->capacity ? 2 * tokens->capacity : 1;
+        json_tape_t *newList = (json_tape_t *)malloc(sizeof(json_tape_t) * capacity);
+        uint32_t *newLengths = (uint32_t *)malloc(sizeof(uint32_t) * capacity);
+
+        if (!newList || !newLengths) {
+            free(newList);
+            free(newLengths);
+            lexer_error(ctx, JSON_ERROR_NO_MEMORY);
+            return;
+        }
+        if (tokens->length) {
+            memcpy(newList, tokens->list, sizeof(json_tape_t) * tokens->length);
+            memcpy(newLengths, tokens->lengths, sizeof(uint32_t) * tokens->length);
+        }
+        free(tokens->list);
+        free(tokens->lengths);
 
         tokens->list = newList;
-        tokens->capacity *= 2;
+        tokens->lengths = newLengths;
+        tokens->capacity = capacity;
     }
 
     t->index = tokens->length;
 
-    tokens->list[tokens->length] = *t;
+    // The text of a string starts after its opening quote, the tape keeps the quote.
+    tokens->list[tokens->length] = JSON_TAPE(t->type, t->type == JLT_STRING ? t->start - 1 : t->start);
+    tokens->lengths[tokens->length] = t->end - t->start < JSON_TAPE_LONG ? (uint32_t)(t->end - t->start) : JSON_TAPE_LONG;
     tokens->length++;
 }
 
-static void get_tok_LPAIR(struct json_lexer_context_t *ctx) {
+/* The one-byte tokens { } [ ] , : whose byte lex_token_at has already classified */
+static void get_tok_CHAR(struct json_lexer_context_t *ctx, enum json_lexer_token_type_t type,
+                         struct json_lexer_token_t *token) {
     size_t start = ctx->offset;
-    size_t end = ctx->offset + 1;
-    size_t startCol = ctx->column;
 
-    match(ctx, '{');
-
-    struct json_lexer_token_t token = {
-        .type = JLT_LPAIR,
-        .text = substring(ctx, start, end),
+    *token = (struct json_lexer_token_t){
+        .type = type,
+        .text = substring(ctx, start, start + 1),
         .index = 0,
         .start = start,
-        .end = end,
-        .column = startCol,
-        .row = ctx->row,
+        .end = start + 1,
+        .column = 0,
+        .row = 0,
     };
 
-    insert_token(ctx, &token);
+    ctx->offset++;
 }
 
-static void get_tok_RPAIR(struct json_lexer_context_t *ctx) {
-    size_t start = ctx->offset;
-    size_t end = ctx->offset + 1;
-    size_t startCol = ctx->column;
-
-    match(ctx, '}');
-
-    struct json_lexer_token_t token = {
-        .type = JLT_RPAIR,
-        .text = substring(ctx, start, end),
-        .index = 0,
-        .start = start,
-        .end = end,
-        .column = startCol,
-        .row = ctx->row,
-    };
-
-    insert_token(ctx, &token);
-}
+static void get_tok_STRING(struct json_lexer_context_t *ctx, struct json_lexer_token_t *token) {
+    size_t start = 0;
+    size_t end = 0;
 
-static void get_tok_LARRAY(struct json_lexer_context_t *ctx) {
-    size_t start = ctx->offset;
-    size_t end = ctx->offset + 1;
-    size_t startCol = ctx->column;
+    match(ctx, '"');
 
-    match(ctx, '[');
+    start = ctx->offset;
 
-    struct json_lexer_token_t token = {
-        .type = JLT_LARRAY,
-        .text = substring(ctx, start, end),
-        .index = 0,
-        .start = start,
-        .end = end,
-        .column = startCol,
-        .row = ctx->row,
-    };
+    // '"' (~["\u0000-\u001F] | '\\' . ) * '"'
+    for (;;) {
+        // jump over plain content a vector at a time
+        size_t n = json_scan_string((const uint8_t *)ctx->from_string + ctx->offset, ctx->from_string_len - ctx->offset);
+        ctx->offset += n;
 
-    insert_token(ctx, &token);
-}
+        int c = lookahead_char(ctx);
+        if (c == '"')
+            break;
 
-static void get_tok_RARRAY(struct json_lexer_context_t *ctx) {
-    size_t start = ctx->offset;
-    size_t end = ctx->offset + 1;
-    size_t startCol = ctx->column;
+        // unterminated, or a raw control character
+        if (c != '\\') {
+            lexer_error(ctx, JSON_ERROR_INVALID_STRING);
+            break;
+        }
 
-    match(ctx, ']');
+        // the escaped byte is checked when the string is decoded
+        next_char(ctx);
+        next_char(ctx);
+    }
 
-    struct json_lexer_token_t token = {
-        .type = JLT_RARRAY,
-        .text = substring(ctx, start, end),
-        .index = 0,
-        .start = start,
-        .end = end,
-        .column = startCol,
-        .row = ctx->row,
-    };
+    end = ctx->offset;
 
-    insert_token(ctx, &token);
-}
+    // escapes are ASCII, so the whole body is checked at once
+    if (ctx->validate_utf8 && !ctx->error.code) {
+        const uint8_t *body = (const uint8_t *)ctx->from_string + start;
 
-static void get_tok_COMMA(struct json_lexer_context_t *ctx) {
-    size_t start = ctx->offset;
-    size_t end = ctx->offset + 1;
-    size_t startCol = ctx->column;
+        if (!json_validate_utf8(body, end - start)) {
+            ctx->offset = start + json_utf8_error_offset(body, end - start);
+            lexer_error(ctx, JSON_ERROR_INVALID_UTF8);
+        }
+    }
 
-    match(ctx, ',');
+    match(ctx, '"');
 
-    struct json_lexer_token_t token = {
-        .type = JLT_COMMA,
+    *token = (struct json_lexer_token_t){
+        .type = JLT_STRING,
         .text = substring(ctx, start, end),
         .index = 0,
         .start = start,
         .end = end,
-        .column = startCol,
-        .row = ctx->row,
+        .column = 0,
+        .row = 0,
     };
-
-    insert_token(ctx, &token);
 }
 
-static void get_tok_COLON(struct json_lexer_context_t *ctx) {
-    size_t start = ctx->offset;
-    size_t end = ctx->offset + 1;
-    size_t startCol = ctx->column;
-
-    match(ctx, ':');
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        return (c | 0x20) - 'a' + 10;
+    return -1;
+}
 
-    struct json_lexer_token_t token = {
-        .type = JLT_COLON,
-        .text = substring(ctx, start, end),
-        .index = 0,
-        .start = start,
-        .end = end,
-        .column = startCol,
-        .row = ctx->row,
-    };
+static bool read_hex4(const char *p, const char *end, uint32_t *out) {
+    uint32_t v = 0;
 
-    insert_token(ctx, &token);
+    if (end - p < 4)
+        return false;
+    for (int i = 0; i < 4; i++) {
+        int d = hex_digit(p[i]);
+        if (d < 0)
+            return false;
+        v = v << 4 | (uint32_t)d;
+    }
+    *out = v;
+    return true;
 }
 
-static void get_tok_STRING(struct json_lexer_context_t *ctx) {
-    size_t start = 0;
-    size_t end = 0;
-    size_t startCol = ctx->column;
-
-    match(ctx, '"');
+/*
+ * Decode the escapes of the string content src[0..len) into dst and return
+ * the decoded length, or SIZE_MAX on an invalid escape or lone surrogate.
+ * The output is never longer than the input, so dst may be src.
+ */
+static size_t unescape_string(char *dst, const char *src, size_t len) {
+    const char *end = src + len;
+    char *out = dst;
+
+    while (src < end) {
+        if (*src != '\\') {
+            // copy the run up to the next escape at once, dst may be src for in situ decoding
+            const char *next = (const char *)memchr(src, '\\', end - src);
+            size_t n = (next ? next : end) - src;
+            memmove(out, src, n);
+            out += n;
+            src += n;
+            continue;
+        }
 
-    start = ctx->offset;
+        if (end - src < 2)
+            return SIZE_MAX;
+        src += 2;
+        switch (src[-1]) {
+        case '"': *out++ = '"'; break;
+        case '\\': *out++ = '\\'; break;
+        case '/': *out++ = '/'; break;
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+        case 'n': *out++ = '\n'; break;
+        case 'r': *out++ = '\r'; break;
+        case 't': *out++ = '\t'; break;
+        case 'u': {
+            uint32_t cp, low;
+            if (!read_hex4(src, end, &cp))
+                return SIZE_MAX;
+            src += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                // a high surrogate must be followed by an escaped low one
+                if (end - src < 6 || src[0] != '\\' || src[1] != 'u' || !read_hex4(src + 2, end, &low) ||
+                    low < 0xDC00 || low > 0xDFFF)
+                    return SIZE_MAX;
+                src += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                return SIZE_MAX;
+            }
 
-    // '"' (~["\r\n] | '\\' . ) * '"'
-    while (!(lookahead(ctx, '"') || lookahead(ctx, '\r') || lookahead(ctx, '\n') || lookahead(ctx, EOF))) {
-        match_if_exist(ctx, '\\');
-        next_char(ctx);
+            if (cp < 0x80) {
+                *out++ = (char)cp;
+            } else if (cp < 0x800) {
+                *out++ = (char)(0xC0 | cp >> 6);
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                *out++ = (char)(0xE0 | cp >> 12);
+                *out++ = (char)(0x80 | (cp >> 6 & 0x3F));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            } else {
+                *out++ = (char)(0xF0 | cp >> 18);
+                *out++ = (char)(0x80 | (cp >> 12 & 0x3F));
+                *out++ = (char)(0x80 | (cp >> 6 & 0x3F));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            }
+            break;
+        }
+        default:
+            return SIZE_MAX;
+        }
     }
 
-    end = ctx->offset;
-
-    match(ctx, '"');
-
-    struct json_lexer_token_t token = {
-        .type = JLT_STRING,
-        .text = substring(ctx, start, end),
-        .index = 0,
-        .start = start,
-        .end = end,
-        .column = startCol,
-        .row = ctx->row,
-    };
+    return (size_t)(out - dst);
+}
+
+/* Same checks as unescape_string, without writing the decoded text. */
+static bool check_escapes(const char *src, size_t len) {
+    const char *end = src + len;
+    uint32_t cp, low;
+
+    while ((src = (const char *)memchr(src, '\\', end - src))) {
+        if (end - src < 2)
+            return false;
+        src += 2;
+        switch (src[-1]) {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            break;
+        case 'u':
+            if (!read_hex4(src, end, &cp))
+                return false;
+            src += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                if (end - src < 6 || src[0] != '\\' || src[1] != 'u' || !read_hex4(src + 2, end, &low) ||
+                    low < 0xDC00 || low > 0xDFFF)
+                    return false;
+                src += 6;
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
 
-    insert_token(ctx, &token);
+    return true;
 }
 
-static void get_tok_NUMBER(struct json_lexer_context_t *ctx) {
+static void get_tok_NUMBER(struct json_lexer_context_t *ctx, struct json_lexer_token_t *token) {
     size_t start = ctx->offset;
     size_t end = 0;
-    size_t startCol = ctx->column;
 
     // NOTE: This implementation uses a simple scan.
     // The valid JSON number format is:
     //   '-'? ('0' | [1-9][0-9]*) ('.' [0-9]+)? ([eE] [+-]? [0-9]+)?
-    // Here, we check if the next character matches any of the valid components:
-    // digits, minus sign, plus sign, decimal point, or exponent indicator.
-    // We loop as long as any valid numeric character is found.
-    while (match_between_if_exist(ctx, '0', '9') || match_if_exist(ctx, '-') || match_if_exist(ctx, '+') ||
-           match_if_exist(ctx, '.') || match_if_exist(ctx, 'e') || match_if_exist(ctx, 'E'))
-        continue;
+    // Here we only take the run of digits, signs, decimal points and
+    // exponent indicators, the format is checked when the number is read.
+    while (ctx->offset < ctx->from_string_len &&
+           (class_at(ctx, ctx->offset) == JCC_NUMBER || class_at(ctx, ctx->offset) == JCC_EXPONENT))
+        ctx->offset++;
 
     end = ctx->offset;
 
-    struct json_lexer_token_t token = {
+    *token = (struct json_lexer_token_t){
         .type = JLT_NUMBER,
         .text = substring(ctx, start, end),
         .index = 0,
         .start = start,
         .end = end,
-        .column = startCol,
-        .row = ctx->row,
+        .column = 0,
+        .row = 0,
     };
-
-    insert_token(ctx, &token);
 }
 
-static void get_tok_TRUE(struct json_lexer_context_t *ctx) {
+static void get_tok_TRUE(struct json_lexer_context_t *ctx, struct json_lexer_token_t *token) {
     size_t start = ctx->offset;
     size_t end = 0;
-    size_t startCol = ctx->column;
 
     match_str(ctx, "true");
 
     end = ctx->offset;
 
-    struct json_lexer_token_t token = {
+    *token = (struct json_lexer_token_t){
         .type = JLT_TRUE,
         .text = substring(ctx, start, end),
         .index = 0,
         .start = start,
         .end = end,
-        .column = startCol,
-        .row = ctx->row,
+        .column = 0,
+        .row = 0,
     };
-
-    insert_token(ctx, &token);
 }
 
-static void get_tok_FALSE(struct json_lexer_context_t *ctx) {
+static void get_tok_FALSE(struct json_lexer_context_t *ctx, struct json_lexer_token_t *token) {
     size_t start = ctx->offset;
     size_t end = 0;
-    size_t startCol = ctx->column;
 
     match_str(ctx, "false");
 
     end = ctx->offset;
 
-    struct json_lexer_token_t token = {
+    *token = (struct json_lexer_token_t){
         .type = JLT_FALSE,
         .text = substring(ctx, start, end),
         .index = 0,
         .start = start,
         .end = end,
-        .column = startCol,
-        .row = ctx->row,
+        .column = 0,
+        .row = 0,
     };
-
-    insert_token(ctx, &token);
 }
 
-static void get_tok_NULL(struct json_lexer_context_t *ctx) {
+static void get_tok_NULL(struct json_lexer_context_t *ctx, struct json_lexer_token_t *token) {
     size_t start = ctx->offset;
     size_t end = 0;
-    size_t startCol = ctx->column;
 
     match_str(ctx, "null");
 
     end = ctx->offset;
 
-    struct json_lexer_token_t token = {
+    *token = (struct json_lexer_token_t){
         .type = JLT_NULL,
         .text = substring(ctx, start, end),
         .index = 0,
         .start = start,
         .end = end,
-        .column = startCol,
-        .row = ctx->row,
+        .column = 0,
+        .row = 0,
     };
-
-    insert_token(ctx, &token);
 }
 
-void json_execute_lexer(struct json_lexer_context_t *ctx) {
+/*
+ * Return the offset of the next structural character at or after the current
+ * offset, or the input length if there is none. Blocks are indexed lazily, so
+ * the lexer only keeps the bitmap of one 64-byte block at a time.
+ */
+static void index_next_block(struct json_lexer_context_t *ctx) {
+    uint8_t block[JSON_BLOCK_SIZE];
+    const uint8_t *in = (const uint8_t *)ctx->from_string + ctx->stage1_offset;
+    size_t remain = ctx->from_string_len - ctx->stage1_offset;
+
+    if (ctx->index) {
+        ctx->structurals = ctx->index[ctx->stage1_offset / JSON_BLOCK_SIZE];
+        ctx->structurals_base = ctx->stage1_offset;
+        ctx->stage1_offset += JSON_BLOCK_SIZE;
+        return;
+    }
 
-    while (!lookahead(ctx, EOF)) {
-
-        if (lookahead(ctx, '{')) {
-            get_tok_LPAIR(ctx);
-        } else if (lookahead(ctx, '}')) {
-            get_tok_RPAIR(ctx);
-        } else if (lookahead(ctx, '[')) {
-            get_tok_LARRAY(ctx);
-        } else if (lookahead(ctx, ']')) {
-            get_tok_RARRAY(ctx);
-        } else if (lookahead(ctx, ',')) {
-            get_tok_COMMA(ctx);
-        } else if (lookahead(ctx, ':')) {
-            get_tok_COLON(ctx);
-        } else if (lookahead(ctx, '"')) {
-            get_tok_STRING(ctx);
-        } else if (lookahead(ctx, '-') || lookahead(ctx, '+') || lookahead(ctx, '.') ||
-                   (lookahead_char(ctx) >= '0' && lookahead_char(ctx) <= '9')) {
-            get_tok_NUMBER(ctx);
-        } else if (lookahead(ctx, 't')) {
-            get_tok_TRUE(ctx);
-        } else if (lookahead(ctx, 'f')) {
-            get_tok_FALSE(ctx);
-        } else if (lookahead(ctx, 'n')) {
-            get_tok_NULL(ctx);
-        } else if (match_if_exist(ctx, '\n')) { // only match "\n", should consider these cases "\r\n" "\r"
-            ctx->row++;
-            ctx->column = 1;
-        } else if (match_if_exist(ctx, ' ') || match_if_exist(ctx, '\t') || match_if_exist(ctx, '\r')) {
-            continue;
-        } else {
-            match(ctx, EOF); // error
+    // The last block is padded with spaces so the kernels never read past the input.
+    if (remain < JSON_BLOCK_SIZE) {
+        memset(block, ' ', JSON_BLOCK_SIZE);
+        memcpy(block, in, remain);
+        in = block;
+    }
+
+    ctx->structurals = json_stage1_block(&ctx->stage1, in);
+    ctx->structurals_base = ctx->stage1_offset;
+    ctx->stage1_offset += JSON_BLOCK_SIZE;
+}
+
+static size_t next_structural(struct json_lexer_context_t *ctx) {
+    for (;;) {
+        while (ctx->structurals) {
+            size_t pos = ctx->structurals_base + __builtin_ctzll(ctx->structurals);
+            // an index computed for the whole input may go on past the end
+            if (pos >= ctx->offset)
+                return pos < ctx->from_string_len ? pos : ctx->from_string_len;
+            ctx->structurals &= ctx->structurals - 1;
         }
+
+        if (ctx->stage1_offset >= ctx->from_string_len)
+            return ctx->from_string_len;
+
+        index_next_block(ctx);
+    }
+}
+
+/*
+ * Index every block up to the one holding pos, which must not be past the
+ * current token, so the input before pos may be rewritten in place. The
+ * skipped blocks lie inside the token and have no structurals left.
+ */
+static void index_through(struct json_lexer_context_t *ctx, size_t pos) {
+    while (ctx->stage1_offset <= pos && ctx->stage1_offset < ctx->from_string_len)
+        index_next_block(ctx);
+}
+
+/*
+ * Everything between two tokens must be whitespace. The structural index
+ * only marks where a scalar starts, so trailing garbage such as the `x` in
+ * `truex` is caught here.
+ */
+static void skip_whitespace(struct json_lexer_context_t *ctx, size_t end) {
+    size_t i = ctx->offset;
+
+    while (i < end && class_at(ctx, i) == JCC_SPACE)
+        i++;
+    ctx->offset = i;
+
+    if (i < end)
+        match(ctx, EOF); // error
+}
+
+/* Lex the token starting at the current offset into `token`. */
+static void lex_token_at(struct json_lexer_context_t *ctx, struct json_lexer_token_t *token) {
+    enum json_char_class_t c = ctx->offset < ctx->from_string_len ? class_at(ctx, ctx->offset) : JCC_INVALID;
+
+    switch (c) {
+    case JCC_LPAIR: get_tok_CHAR(ctx, JLT_LPAIR, token); break;
+    case JCC_RPAIR: get_tok_CHAR(ctx, JLT_RPAIR, token); break;
+    case JCC_LARRAY: get_tok_CHAR(ctx, JLT_LARRAY, token); break;
+    case JCC_RARRAY: get_tok_CHAR(ctx, JLT_RARRAY, token); break;
+    case JCC_COMMA: get_tok_CHAR(ctx, JLT_COMMA, token); break;
+    case JCC_COLON: get_tok_CHAR(ctx, JLT_COLON, token); break;
+    case JCC_QUOTE: get_tok_STRING(ctx, token); break;
+    case JCC_NUMBER: get_tok_NUMBER(ctx, token); break;
+    case JCC_TRUE: get_tok_TRUE(ctx, token); break;
+    case JCC_FALSE: get_tok_FALSE(ctx, token); break;
+    case JCC_NULL: get_tok_NULL(ctx, token); break;
+    default: match(ctx, EOF); break; // error
+    }
+}
+
+/*
+ * Lex the token at the next structural position into `token`.
+ * Return false once the input is exhausted or on an invalid byte.
+ */
+static bool lex_next_token(struct json_lexer_context_t *ctx, struct json_lexer_token_t *token) {
+    skip_whitespace(ctx, next_structural(ctx));
+
+    if (lookahead(ctx, EOF))
+        return false;
+
+    lex_token_at(ctx, token);
+    return ctx->error.code == JSON_ERROR_NONE;
+}
+
+/*
+ * Decode entry `index` of the tape into `token` from its offset and length.
+ * Only a token too long for the lengths array is lexed again, on a copy of
+ * the context so the lexer state is kept. Row and column are left to the
+ * caller.
+ */
+static void tape_token(struct json_lexer_context_t *ctx, size_t index, struct json_lexer_token_t *token) {
+    json_tape_t tape = ctx->tokens.list[index];
+    uint32_t len = ctx->tokens.lengths[index];
+
+    if (len != JSON_TAPE_LONG) {
+        size_t start = JSON_TAPE_OFFSET(tape) + (JSON_TAPE_TYPE(tape) == JLT_STRING);
+
+        *token = (struct json_lexer_token_t){
+            .type = JSON_TAPE_TYPE(tape),
+            .text = substring(ctx, start, start + len),
+            .index = index,
+            .start = start,
+            .end = start + len,
+            .column = 0,
+            .row = 0,
+        };
+        return;
+    }
+
+    struct json_lexer_context_t scan = *ctx;
+
+    scan.offset = JSON_TAPE_OFFSET(tape);
+    lex_token_at(&scan, token);
+    token->index = index;
+    token->row = 0;
+    token->column = 0;
+}
+
+struct json_lexer_token_t json_lexer_token_at(struct json_lexer_context_t *ctx, size_t index) {
+    struct json_lexer_token_t token = {.type = JLT_MISSING};
+
+    if (index >= ctx->tokens.length)
+        return token;
+
+    tape_token(ctx, index, &token);
+    json_lexer_position(ctx, JSON_TAPE_OFFSET(ctx->tokens.list[index]), &token.row, &token.column);
+
+    return token;
+}
+
+void json_execute_lexer(struct json_lexer_context_t *ctx) {
+    struct json_lexer_token_t token;
+
+    while (lex_next_token(ctx, &token)) {
+        insert_token(ctx, &token);
     }
 }
 
@@ -1369,6 +1884,120 @@ void json_execute_lexer(struct json_lexer_context_t *ctx) {
 // !SECTION: END JSON Lexer
 // --------------------------------------------------
 
+// --------------------------------------------------
+// SECTION: JSON Number
+// --------------------------------------------------
+
+/* True if p[0..len) matches -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
+static bool is_number(const char *p, size_t len) {
+    const char *end = p + len;
+
+    if (p < end && *p == '-')
+        p++;
+
+    if (p < end && *p == '0') {
+        p++;
+    } else if (p < end && *p >= '1' && *p <= '9') {
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+    } else {
+        return false;
+    }
+
+    if (p < end && *p == '.') {
+        if (++p == end || *p < '0' || *p > '9')
+            return false;
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+    }
+
+    if (p < end && (*p | 0x20) == 'e') {
+        if (++p < end && (*p == '+' || *p == '-'))
+            p++;
+        if (p == end || *p < '0' || *p > '9')
+            return false;
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+    }
+
+    return p == end;
+}
+
+/*
+ * Decode the number text p[0..len) into a JT_INT, JT_UINT or JT_FLOAT.
+ * Return false if the text is not a strict JSON number or does not fit,
+ * the caller then keeps it as JT_NUMBER text.
+ */
+static bool decode_number(const char *p, size_t len, union json_t *out) {
+    const char *end = p + len;
+    const char *digits;
+    bool negative = false, overflow = false;
+    uint64_t value = 0;
+
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+
+    digits = p;
+    if (p < end && *p == '0') {
+        p++;
+    } else {
+        while (end - p >= 8 && is_eight_digits(p)) {
+            if (p - digits + 8 > 16)
+                break; // 16 digits always fit, the tail goes through the overflow checks below
+            value = value * 100000000 + parse_eight_digits(p);
+            p += 8;
+        }
+        while (p < end && *p >= '0' && *p <= '9') {
+            overflow |= __builtin_mul_overflow(value, 10, &value) ||
+                        __builtin_add_overflow(value, (uint64_t)(*p - '0'), &value);
+            p++;
+        }
+    }
+
+    if (p == digits)
+        return false;
+
+    if (p == end) {
+        if (overflow)
+            return false;
+        if (negative) {
+            if (value > (uint64_t)INT64_MAX + 1)
+                return false;
+            *out = JSON_INT(value == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)value);
+        } else if (value > (uint64_t)INT64_MAX) {
+            *out = JSON_UINT(value);
+        } else {
+            *out = JSON_INT(value);
+        }
+        return true;
+    }
+
+    // fraction or exponent, json_parse_double checks the rest of the grammar
+    double f;
+    if (!json_parse_double(end - len, len, &f) || isinf(f))
+        return false;
+
+    *out = JSON_FLOAT(f);
+    return true;
+}
+
+bool json_decode_number(union json_t *j) {
+    union json_t value;
+
+    if (j->type != JT_NUMBER || !decode_number(j->text, strlen(j->text), &value))
+        return false;
+
+    json_free(j->text);
+    *j = value;
+    return true;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Number
+// --------------------------------------------------
+
 // --------------------------------------------------
 // SECTION: JSON Parser
 // --------------------------------------------------
@@ -1378,8 +2007,12 @@ struct json_parser_context_t *json_create_parser(struct json_lexer_context_t *le
         (struct json_parser_context_t *)malloc(sizeof(struct json_parser_context_t));
 
     struct json_parser_context_t parser = {
+        .config = {0},
         .token_index = 0,
         .lexer = lexer,
+        .on_demand = false,
+        .has_lookahead = false,
+        .error = {.code = JSON_ERROR_NONE},
     };
 
     *parser_p = parser;
@@ -1387,73 +2020,165 @@ struct json_parser_context_t *json_create_parser(struct json_lexer_context_t *le
     return parser_p;
 }
 
-void json_delete_parser(struct json_parser_context_t *ctx) { free(ctx); }
+void json_delete_parser(struct json_parser_context_t *ctx) {
+    free(ctx->members.pairs);
+    free(ctx);
+}
 
+/* Both modes decode the last matched token into ctx->current. */
 static struct json_lexer_token_t *current_token(struct json_parser_context_t *ctx) {
-    size_t index = ctx->token_index - 1;
-    if (index >= ctx->lexer->tokens.length)
-        return NULL;
-    return &ctx->lexer->tokens.list[index];
+    return ctx->token_index ? &ctx->current : NULL;
 }
 
-static void match_token(struct json_parser_context_t *ctx, enum json_lexer_token_type_t t) {
-    size_t index = ctx->token_index;
-
-    // always get next token before checking
-    ctx->token_index++;
-
-    if (index >= ctx->lexer->tokens.length) {
-        JSON_LOG_ERROR("Invalid Token: index=%lu expect=<%d|%s>", index, t, json_lexer_type2str(t));
-        json_print_trace();
-        assert(0);
-    }
-
-    if (ctx->lexer->tokens.list[index].type != t) {
-        JSON_LOG_ERROR("Syntax Error: Unexpected Token: index=%lu token=<%d|%s> expect=<%d|%s>", index,
-                ctx->lexer->tokens.list[index].type, json_lexer_type2str(ctx->lexer->tokens.list[index].type), t,
-                json_lexer_type2str(t));
-        json_print_trace();
-        assert(0);
+/*
+ * On-demand mode: make sure the lookahead slot holds the next token.
+ * The slot holds a JLT_MISSING token at the end of the input.
+ */
+static struct json_lexer_token_t *fill_lookahead(struct json_parser_context_t *ctx) {
+    if (!ctx->has_lookahead) {
+        if (lex_next_token(ctx->lexer, &ctx->lookahead)) {
+            ctx->lookahead.index = ctx->token_index;
+        } else {
+            ctx->lookahead.type = JLT_MISSING;
+        }
+        ctx->has_lookahead = true;
     }
+    return &ctx->lookahead;
 }
 
 static bool lookahead_n_token(struct json_parser_context_t *ctx, int n, enum json_lexer_token_type_t t) {
     size_t index = ctx->token_index + n;
 
+    if (ctx->on_demand) {
+        // only one token of lookahead is available without a token list
+        assert(n == 0);
+        return fill_lookahead(ctx)->type == t;
+    }
+
     if (index >= ctx->lexer->tokens.length) {
         return false;
     }
 
-    return ctx->lexer->tokens.list[index].type == t;
+    return JSON_TAPE_TYPE(ctx->lexer->tokens.list[index]) == t;
 }
 
 static bool lookahead_token(struct json_parser_context_t *ctx, enum json_lexer_token_type_t t) {
     return lookahead_n_token(ctx, 0, t);
 }
 
+static void parser_error(struct json_parser_context_t *ctx, enum json_error_code code, size_t offset) {
+    set_error(&ctx->error, code, offset);
+}
+
+/* Offset of the first character of a token, the opening quote for strings. */
+static size_t token_offset(const struct json_lexer_token_t *token) {
+    return token->type == JLT_STRING ? token->start - 1 : token->start;
+}
+
+/* True if every token has been matched. */
+static bool at_end(struct json_parser_context_t *ctx) {
+    if (ctx->on_demand)
+        return fill_lookahead(ctx)->type == JLT_MISSING;
+    return ctx->token_index >= ctx->lexer->tokens.length;
+}
+
+/*
+ * Report the next token with `code`. Without a next token, the lexer either
+ * stopped on an invalid byte or the input ended early.
+ */
+static void unexpected_token(struct json_parser_context_t *ctx, enum json_error_code code) {
+    struct json_lexer_context_t *lexer = ctx->lexer;
+
+    if (!at_end(ctx)) {
+        parser_error(ctx, code,
+                     ctx->on_demand ? token_offset(&ctx->lookahead)
+                                    : JSON_TAPE_OFFSET(lexer->tokens.list[ctx->token_index]));
+    } else if (lexer->error.code) {
+        parser_error(ctx, lexer->error.code, lexer->error.offset);
+    } else {
+        parser_error(ctx, JSON_ERROR_UNEXPECTED_EOF, lexer->from_string_len);
+    }
+}
+
+/* Consume the next token if it has type `t`, otherwise record the error and return false. */
+static bool match_token(struct json_parser_context_t *ctx, enum json_lexer_token_type_t t) {
+    size_t index = ctx->token_index;
+
+    if (!lookahead_token(ctx, t)) {
+        unexpected_token(ctx, JSON_ERROR_UNEXPECTED_TOKEN);
+        return false;
+    }
+
+    if (ctx->on_demand) {
+        ctx->current = ctx->lookahead;
+        ctx->has_lookahead = false;
+    } else {
+        tape_token(ctx->lexer, index, &ctx->current);
+    }
+
+    ctx->token_index++;
+    return true;
+}
+
+/*
+ * Return the decoded text of a string token. The text is copied unless the
+ * parse is in situ, then it is decoded and terminated inside the input.
+ * Return NULL on an invalid escape.
+ */
+static char *token_string(struct json_parser_context_t *ctx, struct json_lexer_token_t *token) {
+    size_t len = token->end - token->start;
+    bool escaped = memchr(token->text, '\\', len) != NULL;
+    char *text;
+
+    if (ctx->config.in_situ) {
+        index_through(ctx->lexer, token->end);
+        text = (char *)token->text;
+    } else if (!escaped) {
+        return json_strndup(token->text, len);
+    } else {
+        text = (char *)json_malloc(len + 1);
+    }
+
+    if (escaped)
+        len = unescape_string(text, token->text, len);
+
+    if (len == SIZE_MAX) {
+        parser_error(ctx, JSON_ERROR_INVALID_ESCAPE, token_offset(token));
+        if (!ctx->config.in_situ)
+            json_free(text);
+        return NULL;
+    }
+
+    text[len] = '\0';
+    return text;
+}
+
 // Forward declarations for the recursive descent parser rules.
 static union json_t object_rule(struct json_parser_context_t *ctx);
 static union json_t array_rule(struct json_parser_context_t *ctx);
 static union json_t value_rule(struct json_parser_context_t *ctx);
 
-static union json_t value_rule(struct json_parser_context_t *ctx) {
+static union json_t scalar_rule(struct json_parser_context_t *ctx) {
     struct json_lexer_token_t *token_p;
+    char *text;
 
-    // value : obj | arr | STRING | NUMBER | 'true' | 'false' | 'null' ;
+    // scalar : STRING | NUMBER | 'true' | 'false' | 'null' ;
     union json_t j;
 
-    if (lookahead_token(ctx, JLT_LPAIR)) {
-        j = object_rule(ctx);
-    } else if (lookahead_token(ctx, JLT_LARRAY)) {
-        j = array_rule(ctx);
-    } else if (lookahead_token(ctx, JLT_STRING)) {
+    if (lookahead_token(ctx, JLT_STRING)) {
         match_token(ctx, JLT_STRING);
-        token_p = current_token(ctx);
-        j = JSON_STRING(json_strndup(token_p->text, token_p->end - token_p->start));
+        if (!(text = token_string(ctx, current_token(ctx))))
+            return JSON_MISSING;
+        j = JSON_STRING(text);
     } else if (lookahead_token(ctx, JLT_NUMBER)) {
         match_token(ctx, JLT_NUMBER);
         token_p = current_token(ctx);
-        j = JSON_NUMBER(json_strndup(token_p->text, token_p->end - token_p->start));
+        if (!is_number(token_p->text, token_p->end - token_p->start)) {
+            parser_error(ctx, JSON_ERROR_INVALID_NUMBER, token_p->start);
+            return JSON_MISSING;
+        }
+        if (!ctx->config.typed_numbers || !decode_number(token_p->text, token_p->end - token_p->start, &j))
+            j = JSON_NUMBER(json_strndup(token_p->text, token_p->end - token_p->start));
     } else if (lookahead_token(ctx, JLT_TRUE)) {
         match_token(ctx, JLT_TRUE);
         j = JSON_TRUE;
@@ -1464,49 +2189,126 @@ static union json_t value_rule(struct json_parser_context_t *ctx) {
         match_token(ctx, JLT_NULL);
         j = JSON_NULL;
     } else {
-        token_p = current_token(ctx);
-        JSON_LOG_ERROR("Syntax Error: Unexpected Token: index=%lu token=<%d|%s>", ctx->token_index, token_p->type,
-                json_lexer_type2str(token_p->type));
-        json_print_trace();
-        assert(0);
         // Syntax Error: Unexpected Token
+        unexpected_token(ctx, JSON_ERROR_UNEXPECTED_TOKEN);
+        return JSON_MISSING;
     }
 
     return j;
 }
 
-static union json_t object_rule(struct json_parser_context_t *ctx) {
+/* Return NULL on a syntax error. */
+static char *key_rule(struct json_parser_context_t *ctx) {
+    char *key;
+
+    // key : STRING ':' ;
+    if (!match_token(ctx, JLT_STRING))
+        return NULL;
+    if (!(key = token_string(ctx, current_token(ctx))))
+        return NULL;
+    if (!match_token(ctx, JLT_COLON)) {
+        json_free(key);
+        return NULL;
+    }
+
+    return key;
+}
+
+static union json_t value_rule(struct json_parser_context_t *ctx) {
+    // value : obj | arr | scalar ;
+    if (lookahead_token(ctx, JLT_LPAIR))
+        return object_rule(ctx);
+    if (lookahead_token(ctx, JLT_LARRAY))
+        return array_rule(ctx);
+    return scalar_rule(ctx);
+}
+
+/* Queue a member of an open object, taking ownership of key and value. */
+static bool members_push(struct json_parser_context_t *ctx, struct json_obj_members_t *m, char *key,
+                         union json_t value) {
+    if (m->length == m->capacity) {
+        size_t capacity = m->capacity ? 2 * m->capacity : 64;
+        struct json_pair_t *grown = (struct json_pair_t *)realloc(m->pairs, capacity * sizeof(struct json_pair_t));
+        if (!grown) {
+            json_free(key);
+            json_clean(&value);
+            parser_error(ctx, JSON_ERROR_NO_MEMORY, token_offset(current_token(ctx)));
+            return false;
+        }
+        m->pairs = grown;
+        m->capacity = capacity;
+    }
+    m->pairs[m->length++] = (struct json_pair_t){.key = key, .value = value};
+    return true;
+}
+
+/* Release the members queued since first. */
+static void members_drop(struct json_obj_members_t *m, size_t first) {
+    for (size_t i = first; i < m->length; i++) {
+        json_free(m->pairs[i].key);
+        json_clean(&m->pairs[i].value);
+    }
+    m->length = first;
+}
+
+/*
+ * Build the object from the members queued since first, with a table sized
+ * for all of them. A repeated key keeps its first position and its last value.
+ * If memory runs out the members are released and the parse fails.
+ */
+static union json_t members_build(struct json_parser_context_t *ctx, struct json_obj_members_t *m, size_t first) {
     union json_t jobj = JSON_OBJECT;
-    struct json_lexer_token_t *key_tok;
-    size_t key_len;
-    const char *key;
+    bool ok;
+
+    if (m->length == first)
+        return jobj;
+
+    ok = jsonext_obj_reserve(&jobj, m->length - first);
+    if (!ok)
+        members_drop(m, first);
+    for (size_t i = first; i < m->length; i++)
+        ok &= obj_emplace(&jobj, m->pairs[i].key, m->pairs[i].value);
+    m->length = first;
+
+    if (!ok) {
+        json_clean(&jobj);
+        parser_error(ctx, JSON_ERROR_NO_MEMORY, token_offset(current_token(ctx)));
+        return JSON_MISSING;
+    }
+    return jobj;
+}
+
+static union json_t object_rule(struct json_parser_context_t *ctx) {
+    size_t first = ctx->members.length;
+    char *key;
     union json_t value;
 
-    // pair : STRING ':' value ;
+    // pair : key value ;
     // object : LPAIR pair (',' pair)* RPAIR | LPAIR RPAIR;
     match_token(ctx, JLT_LPAIR);
 
-    while (!lookahead_token(ctx, JLT_RPAIR)) {
-        /* Key */
-        match_token(ctx, JLT_STRING);
-        key_tok = current_token(ctx);
-        key_len = key_tok->end - key_tok->start;
-        key = key_tok->text;
-
-        match_token(ctx, JLT_COLON);
+    if (lookahead_token(ctx, JLT_RPAIR)) {
+        match_token(ctx, JLT_RPAIR);
+        return JSON_OBJECT;
+    }
 
-        /* Value */
+    do {
+        if (!(key = key_rule(ctx)))
+            break;
         value = value_rule(ctx);
-        json_set_obj_value_np(&jobj, key, key_len, &value);
-
-        if (lookahead_token(ctx, JLT_COMMA)) {
-            match_token(ctx, JLT_COMMA);
+        if (ctx->error.code) {
+            json_free(key);
+            break;
         }
-    }
+        if (!members_push(ctx, &ctx->members, key, value))
+            break;
+    } while (lookahead_token(ctx, JLT_COMMA) && match_token(ctx, JLT_COMMA));
 
-    match_token(ctx, JLT_RPAIR);
+    if (!ctx->error.code && match_token(ctx, JLT_RPAIR))
+        return members_build(ctx, &ctx->members, first);
 
-    return jobj;
+    members_drop(&ctx->members, first);
+    return JSON_MISSING;
 }
 
 static union json_t array_rule(struct json_parser_context_t *ctx) {
@@ -1516,78 +2318,2611 @@ static union json_t array_rule(struct json_parser_context_t *ctx) {
     // array : LARRAY value (',' value)* RARRAY | LARRAY RARRAY ;
     match_token(ctx, JLT_LARRAY);
 
-    while (!lookahead_token(ctx, JLT_RARRAY)) {
+    if (lookahead_token(ctx, JLT_RARRAY)) {
+        match_token(ctx, JLT_RARRAY);
+        return jarr;
+    }
+
+    do {
         value = value_rule(ctx);
+        if (ctx->error.code)
+            break;
         json_append_value_p(&jarr, &value);
+    } while (lookahead_token(ctx, JLT_COMMA) && match_token(ctx, JLT_COMMA));
 
-        if (lookahead_token(ctx, JLT_COMMA)) {
-            match_token(ctx, JLT_COMMA);
-        }
+    if (!ctx->error.code && match_token(ctx, JLT_RARRAY))
+        return jarr;
+
+    json_clean(&jarr);
+    return JSON_MISSING;
+}
+
+/* Anything after the root value is an error. On error the partial tree is released. Frees the member buffer. */
+static void parse_end(struct json_parser_context_t *ctx) {
+    free(ctx->members.pairs);
+    ctx->members = (struct json_obj_members_t){NULL, 0, 0};
+
+    if (!ctx->error.code && (!at_end(ctx) || ctx->lexer->error.code))
+        unexpected_token(ctx, JSON_ERROR_TRAILING_DATA);
+
+    if (ctx->error.code && ctx->root.type != JT_MISSING) {
+        json_clean(&ctx->root);
+        ctx->root = JSON_MISSING;
     }
+}
+
+void json_parse_recursive(struct json_parser_context_t *ctx) {
+    // json : value EOF;
+    ctx->root = value_rule(ctx);
+    parse_end(ctx);
+}
+
+/*
+ * Same grammar as the rules above, but the open containers live on a heap
+ * stack instead of the C stack. Input nested deeper than max_depth is
+ * rejected and the partial tree is released.
+ */
+static union json_t parse_iterative(struct json_parser_context_t *ctx) {
+    size_t max_depth = ctx->config.max_depth ? ctx->config.max_depth : JSON_MAX_DEPTH;
+    struct json_parse_frame_t *stack = NULL, *top;
+    struct json_obj_members_t members = {NULL, 0, 0};
+    size_t depth = 0, capacity = 0;
+    union json_t value;
+
+    for (;;) {
+        /* Descend into a container, or read a scalar */
+        if (lookahead_token(ctx, JLT_LPAIR) || lookahead_token(ctx, JLT_LARRAY)) {
+            bool is_obj = lookahead_token(ctx, JLT_LPAIR);
+            enum json_lexer_token_type_t close = is_obj ? JLT_RPAIR : JLT_RARRAY;
+
+            match_token(ctx, is_obj ? JLT_LPAIR : JLT_LARRAY);
+
+            if (depth == max_depth) {
+                parser_error(ctx, JSON_ERROR_DEPTH, current_token(ctx)->start);
+                goto fail;
+            }
+
+            if (depth == capacity) {
+                size_t grown_capacity = capacity ? 2 * capacity : 32;
+                struct json_parse_frame_t *grown =
+                    (struct json_parse_frame_t *)realloc(stack, grown_capacity * sizeof(struct json_parse_frame_t));
+                if (!grown) {
+                    parser_error(ctx, JSON_ERROR_NO_MEMORY, current_token(ctx)->start);
+                    goto fail;
+                }
+                stack = grown;
+                capacity = grown_capacity;
+            }
+            top = &stack[depth++];
+            top->container = is_obj ? JSON_OBJECT : JSON_ARRAY;
+            top->key = NULL;
+            top->first = members.length;
+
+            if (!lookahead_token(ctx, close)) {
+                if (is_obj && !(top->key = key_rule(ctx)))
+                    goto fail;
+                continue;
+            }
+
+            match_token(ctx, close);
+            value = stack[--depth].container;
+        } else {
+            value = scalar_rule(ctx);
+            if (ctx->error.code)
+                goto fail;
+        }
+
+        /* Ascend: store the value, closing every container that ends here */
+        for (;;) {
+            if (depth == 0) {
+                free(stack);
+                free(members.pairs);
+                return value;
+            }
+
+            top = &stack[depth - 1];
+            bool is_obj = top->container.type == JT_OBJECT;
 
-    match_token(ctx, JLT_RARRAY);
+            if (is_obj) {
+                char *key = top->key;
+                top->key = NULL;
+                if (!members_push(ctx, &members, key, value))
+                    goto fail;
+            } else {
+                json_append_value_p(&top->container, &value);
+            }
+
+            if (lookahead_token(ctx, JLT_COMMA)) {
+                match_token(ctx, JLT_COMMA);
+                if (is_obj && !(top->key = key_rule(ctx)))
+                    goto fail;
+                break;
+            }
+
+            if (!match_token(ctx, is_obj ? JLT_RPAIR : JLT_RARRAY))
+                goto fail;
 
-    return jarr;
+            value = is_obj ? members_build(ctx, &members, top->first) : top->container;
+            depth--;
+            if (ctx->error.code)
+                goto fail;
+        }
+    }
+
+fail:
+    for (; depth > 0; depth--) {
+        json_free(stack[depth - 1].key);
+        json_clean(&stack[depth - 1].container);
+    }
+    free(stack);
+    members_drop(&members, 0);
+    free(members.pairs);
+    return JSON_MISSING;
 }
 
 void json_parse(struct json_parser_context_t *ctx) {
     // json : value EOF;
-    ctx->root = value_rule(ctx);
+    ctx->root = parse_iterative(ctx);
+    parse_end(ctx);
 }
 
 union json_t json_deserialize(const char *input_text) {
-    struct json_lexer_context_t *lexer = json_create_lexer(input_text);
-    struct json_parser_context_t *parser = json_create_parser(lexer);
+    return __json_deserialize_with(input_text, (struct json_parse_config){0});
+}
+
+union json_t __json_deserialize_with(const char *input_text, struct json_parse_config config) {
+    return __json_deserialize_n_with(input_text, strlen(input_text), config);
+}
+
+static bool parse_parallel(const char *buf, size_t len, struct json_parse_config config, size_t chunk_size,
+                           union json_t *out);
+
+/* Copy error to *out if out is set, with its row and column in text. */
+static void report_error(struct json_error_t *out, const char *text, struct json_error_t error) {
+    if (!out)
+        return;
+
+    *out = error;
+    // row and column are only worth counting for a failed parse
+    if (error.code) {
+        out->row = 1;
+        out->column = 1;
+        advance_position(text, 0, error.offset, &out->row, &out->column);
+    }
+}
+
+union json_t __json_deserialize_n_with(const char *input_text, size_t len, struct json_parse_config config) {
+    if (config.threads > 1 && !config.doc && !active_doc && len >= JSON_PARALLEL_MIN) {
+        union json_t j;
+
+        if (parse_parallel(input_text, len, config, len / (4 * config.threads), &j)) {
+            if (config.error)
+                *config.error = (struct json_error_t){.code = JSON_ERROR_NONE};
+            return j;
+        }
+    }
+
+    struct json_lexer_context_t lexer;
+    struct json_parser_context_t *parser = json_create_parser(&lexer);
+
+    init_lexer(&lexer, input_text, len);
+    lexer.validate_utf8 = config.validate_utf8;
 
-    json_execute_lexer(lexer);
-    json_print_lexer(lexer);
+    if (config.in_situ && !config.doc) {
+        JSON_LOG_WARNING("In-situ parsing needs a document, copying strings instead");
+        config.in_situ = false;
+    }
+
+    // Lex while parsing, the token list is never built.
+    parser->config = config;
+    parser->on_demand = true;
+    if (config.doc)
+        json_doc_begin(config.doc);
     json_parse(parser);
+    if (config.doc)
+        json_doc_end(config.doc);
 
     union json_t j = parser->root;
 
-    json_delete_lexer(lexer);
+    report_error(config.error, input_text, parser->error);
     json_delete_parser(parser);
 
     return j;
 }
 
+static void keep_root(union json_t value, void *args) { *(union json_t *)args = value; }
+
+/* End a stream that collected its root with keep_root. */
+static union json_t finish_root(struct json_stream_t *stream, union json_t j) {
+    // data after the root is an error too, drop the root in that case
+    if (json_stream_finish(stream) && j.type != JT_MISSING) {
+        json_clean(&j);
+        j = JSON_MISSING;
+    }
+
+    json_stream_free(stream);
+    return j;
+}
+
+/* Read in chunks through a stream, so pipes and sockets work and the size is never needed. */
 union json_t json_load(FILE *f) {
+    union json_t j = JSON_MISSING;
+    char chunk[JSON_STREAM_CHUNK];
+    size_t n;
+
     if (!f) {
         JSON_LOG_WARNING("NULL file pointer");
         return JSON_MISSING;
     }
 
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    char *file_content = (char *)malloc(file_size + 1);
-    if (!file_content) {
-        JSON_LOG_ERROR("Memory allocation failed");
-        fclose(f);
+    struct json_stream_t *stream = json_stream_new(.callback = keep_root, .args = &j);
+    if (!stream)
         return JSON_MISSING;
-    }
 
-    fread(file_content, 1, file_size, f);
-    file_content[file_size] = '\0';
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        if (json_stream_feed(stream, chunk, n))
+            break;
+    }
 
-    union json_t j = json_deserialize(file_content);
-    free(file_content);
-    return j;
+    return finish_root(stream, j);
 }
 
-union json_t json_file(const char *file_path) {
-    FILE *f = fopen(file_path, "r");
-    if (!f) {
-        JSON_LOG_WARNING("Could not open file: %s", file_path);
+/* Same as json_load on a descriptor, for pipes, sockets and other files that cannot be mapped. */
+static union json_t load_fd(int fd) {
+    union json_t j = JSON_MISSING;
+    char chunk[JSON_STREAM_CHUNK];
+    ssize_t n;
+
+    struct json_stream_t *stream = json_stream_new(.callback = keep_root, .args = &j);
+    if (!stream)
         return JSON_MISSING;
+
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        if (json_stream_feed(stream, chunk, n))
+            break;
     }
 
-    union json_t j = json_load(f);
-    fclose(f);
-    return j;
+    return finish_root(stream, j);
 }
 
-// --------------------------------------------------
-// !SECTION: END JSON Parser
+/*
+ * Map a non-empty regular file, private to this process. Return NULL for
+ * anything else, the caller then reads the file instead.
+ */
+static char *map_file(int fd, size_t *len, bool writable) {
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+        return NULL;
+
+    void *map = mmap(NULL, st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    // the lexer reads the mapping once from front to back
+    posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    *len = st.st_size;
+    return (char *)map;
+}
+
+/* Lex straight from a mapping of the file, there is no copy and no strlen. */
+union json_t json_file(const char *file_path) {
+    size_t len = 0;
+    union json_t j;
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        JSON_LOG_WARNING("Could not open file: %s", file_path);
+        return JSON_MISSING;
+    }
+
+    char *map = map_file(fd, &len, false);
+    if (map) {
+        j = __json_deserialize_n_with(map, len, (struct json_parse_config){0});
+        munmap(map, len);
+    } else {
+        j = load_fd(fd);
+    }
+
+    close(fd);
+    return j;
+}
+
+
+// --------------------------------------------------
+// !SECTION: END JSON Parser
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON Parallel Parser
+// --------------------------------------------------
+
+/*
+ * An array or object root is parsed in four parallel passes over chunks of
+ * whole 64-byte blocks:
+ *   1. Index every chunk as if it started outside a string. Whether its first
+ *      byte is escaped is known exactly from the backslashes before it.
+ *   2. Carry the quote parity across the chunks (prefix xor), index again the
+ *      chunks that start inside a string, and sum the bracket depth.
+ *   3. Find the first comma at depth 1 of every chunk. These commas split the
+ *      members of the root into ranges.
+ *   4. Parse the ranges on lexers of their own that read the shared index.
+ * The members are then moved into the root in input order. On any error the
+ * input is parsed again on one thread, which reports it.
+ */
+struct parallel_chunk_t {
+    size_t start;
+    size_t end;
+    uint64_t in_string;  /* all ones if the chunk starts inside a string */
+    uint64_t out_string; /* string state at the end, for in_string 0 */
+    long depth;          /* bracket depth at the start, the change in pass 2 */
+    size_t split;        /* first comma at depth 1, SIZE_MAX if none */
+};
+
+struct parallel_range_t {
+    size_t start;
+    size_t end;
+    struct json_parse_frame_t *members;
+    size_t count;
+    bool failed;
+};
+
+struct parallel_parse_t {
+    const char *buf;
+    size_t len;
+    struct json_parse_config config;
+    bool is_obj;
+    uint64_t *index;
+    struct parallel_chunk_t *chunks;
+    size_t chunk_count;
+    struct parallel_range_t *ranges;
+    size_t range_count;
+};
+
+typedef void (*parallel_fn)(struct parallel_parse_t *p, size_t i);
+
+struct parallel_for_t {
+    parallel_fn fn;
+    struct parallel_parse_t *p;
+    size_t n;
+    size_t next;
+};
+
+static void *parallel_worker(void *arg) {
+    struct parallel_for_t *t = (struct parallel_for_t *)arg;
+    size_t i;
+
+    while ((i = __atomic_fetch_add(&t->next, 1, __ATOMIC_RELAXED)) < t->n)
+        t->fn(t->p, i);
+    return NULL;
+}
+
+/* Call fn(p, i) for every i < n on up to `threads` threads, the calling one included. */
+static void parallel_for(size_t threads, size_t n, parallel_fn fn, struct parallel_parse_t *p) {
+    struct parallel_for_t t = {.fn = fn, .p = p, .n = n, .next = 0};
+    pthread_t *workers = (pthread_t *)malloc((threads - 1) * sizeof(pthread_t));
+    size_t started = 0;
+
+    for (; workers && started + 1 < threads && started + 1 < n; started++) {
+        if (pthread_create(&workers[started], NULL, parallel_worker, &t) != 0)
+            break;
+    }
+
+    parallel_worker(&t);
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+    free(workers);
+}
+
+/* Index the blocks of a chunk, which starts inside a string if in_string is all ones. */
+static void index_chunk(struct parallel_parse_t *p, struct parallel_chunk_t *c, uint64_t in_string) {
+    struct json_stage1_t s = {.prev_in_string = in_string};
+    size_t run = 0;
+
+    if (c->start) {
+        // a backslash run escapes the byte after it if its length is odd
+        while (run < c->start && p->buf[c->start - 1 - run] == '\\')
+            run++;
+        s.prev_escaped = run & 1;
+        s.prev_scalar = !memchr(" \t\n\r{}[],:\"", p->buf[c->start - 1], 11);
+    }
+
+    for (size_t b = c->start; b < c->end; b += JSON_BLOCK_SIZE) {
+        uint8_t block[JSON_BLOCK_SIZE];
+        const uint8_t *in = (const uint8_t *)p->buf + b;
+
+        if (p->len - b < JSON_BLOCK_SIZE) {
+            memset(block, ' ', JSON_BLOCK_SIZE);
+            memcpy(block, in, p->len - b);
+            in = block;
+        }
+        p->index[b / JSON_BLOCK_SIZE] = json_stage1_block(&s, in);
+    }
+
+    c->out_string = s.prev_in_string;
+}
+
+static void pass_index(struct parallel_parse_t *p, size_t i) { index_chunk(p, &p->chunks[i], 0); }
+
+static void pass_depth(struct parallel_parse_t *p, size_t i) {
+    struct parallel_chunk_t *c = &p->chunks[i];
+
+    // the guess of pass 1 was wrong
+    if (c->in_string)
+        index_chunk(p, c, c->in_string);
+
+    c->depth = 0;
+    for (size_t b = c->start; b < c->end; b += JSON_BLOCK_SIZE) {
+        for (uint64_t bits = p->index[b / JSON_BLOCK_SIZE]; bits; bits &= bits - 1) {
+            char ch = p->buf[b + __builtin_ctzll(bits)];
+            c->depth += (ch == '[' || ch == '{') - (ch == ']' || ch == '}');
+        }
+    }
+}
+
+static void pass_split(struct parallel_parse_t *p, size_t i) {
+    struct parallel_chunk_t *c = &p->chunks[i];
+    long depth = c->depth;
+
+    c->split = SIZE_MAX;
+    for (size_t b = c->start; b < c->end; b += JSON_BLOCK_SIZE) {
+        for (uint64_t bits = p->index[b / JSON_BLOCK_SIZE]; bits; bits &= bits - 1) {
+            size_t pos = b + __builtin_ctzll(bits);
+            char ch = p->buf[pos];
+
+            if (ch == ',' && depth == 1) {
+                c->split = pos;
+                return;
+            }
+            depth += (ch == '[' || ch == '{') - (ch == ']' || ch == '}');
+        }
+    }
+}
+
+/* Parse the members of the root in one range, which holds at least one. */
+static void pass_parse(struct parallel_parse_t *p, size_t i) {
+    struct parallel_range_t *r = &p->ranges[i];
+    struct json_lexer_context_t lexer;
+    struct json_parser_context_t parser = {
+        .config = p->config,
+        .lexer = &lexer,
+        .on_demand = true,
+        .error = {.code = JSON_ERROR_NONE},
+    };
+    size_t capacity = 0;
+
+    init_lexer(&lexer, p->buf, p->len);
+    lexer.validate_utf8 = p->config.validate_utf8;
+    lexer.index = p->index;
+    seek_lexer(&lexer, r->start, r->end);
+
+    do {
+        struct json_parse_frame_t member = {.key = NULL};
+
+        if (p->is_obj && !(member.key = key_rule(&parser)))
+            break;
+        member.container = parse_iterative(&parser);
+        if (parser.error.code) {
+            json_free(member.key);
+            break;
+        }
+
+        if (r->count == capacity) {
+            size_t grown_capacity = capacity ? 2 * capacity : 64;
+            struct json_parse_frame_t *grown = (struct json_parse_frame_t *)realloc(
+                r->members, grown_capacity * sizeof(struct json_parse_frame_t));
+            if (!grown) {
+                json_free(member.key);
+                json_clean(&member.container);
+                parser_error(&parser, JSON_ERROR_NO_MEMORY, token_offset(current_token(&parser)));
+                break;
+            }
+            r->members = grown;
+            capacity = grown_capacity;
+        }
+        r->members[r->count++] = member;
+    } while (lookahead_token(&parser, JLT_COMMA) && match_token(&parser, JLT_COMMA));
+
+    r->failed = parser.error.code || !at_end(&parser) || lexer.error.code;
+}
+
+/* Find the root container and split its members into ranges. Return false if it cannot be split. */
+static bool split_root(struct parallel_parse_t *p) {
+    size_t open = 0, close = p->len;
+
+    while (open < p->len && memchr(" \t\n\r", p->buf[open], 4))
+        open++;
+    while (close > open && memchr(" \t\n\r", p->buf[close - 1], 4))
+        close--;
+    if (close - open < 2)
+        return false;
+    close--;
+
+    p->is_obj = p->buf[open] == '{';
+    if (p->buf[open] != (p->is_obj ? '{' : '[') || p->buf[close] != (p->is_obj ? '}' : ']'))
+        return false;
+    // the closing bracket may be the last byte of an unterminated string
+    if (!(p->index[close / JSON_BLOCK_SIZE] >> (close % JSON_BLOCK_SIZE) & 1))
+        return false;
+
+    p->ranges = (struct parallel_range_t *)calloc(p->chunk_count + 1, sizeof(struct parallel_range_t));
+    if (!p->ranges)
+        return false;
+
+    size_t start = open + 1;
+    for (size_t i = 0; i < p->chunk_count; i++) {
+        size_t split = p->chunks[i].split;
+        if (split > open && split < close) {
+            p->ranges[p->range_count++] = (struct parallel_range_t){.start = start, .end = split};
+            start = split + 1;
+        }
+    }
+    p->ranges[p->range_count++] = (struct parallel_range_t){.start = start, .end = close};
+
+    return p->range_count > 1;
+}
+
+/*
+ * Parse buf[0..len) on config.threads threads, in chunks of about chunk_size
+ * bytes. Return false if the root is not a container that can be split or
+ * the input is not valid, the caller then parses it on one thread.
+ */
+static bool parse_parallel(const char *buf, size_t len, struct json_parse_config config, size_t chunk_size,
+                           union json_t *out) {
+    size_t max_depth = config.max_depth ? config.max_depth : JSON_MAX_DEPTH;
+    size_t blocks = (len + JSON_BLOCK_SIZE - 1) / JSON_BLOCK_SIZE;
+    size_t chunk_blocks = chunk_size / JSON_BLOCK_SIZE ? chunk_size / JSON_BLOCK_SIZE : 1;
+    struct parallel_parse_t p = {.buf = buf, .len = len, .config = config};
+    uint64_t in_string = 0;
+    long depth = 0;
+    size_t total = 0;
+    bool ok = false;
+
+    // the members sit one level below the root
+    if (max_depth < 2)
+        return false;
+    p.config.max_depth = max_depth - 1;
+    p.config.error = NULL;
+
+    p.chunk_count = (blocks + chunk_blocks - 1) / chunk_blocks;
+    p.index = (uint64_t *)malloc(blocks * sizeof(uint64_t));
+    p.chunks = (struct parallel_chunk_t *)calloc(p.chunk_count, sizeof(struct parallel_chunk_t));
+    if (!p.index || !p.chunks)
+        goto done;
+
+    for (size_t i = 0; i < p.chunk_count; i++) {
+        p.chunks[i].start = i * chunk_blocks * JSON_BLOCK_SIZE;
+        p.chunks[i].end = i + 1 < p.chunk_count ? (i + 1) * chunk_blocks * JSON_BLOCK_SIZE : len;
+    }
+
+    parallel_for(config.threads, p.chunk_count, pass_index, &p);
+
+    for (size_t i = 0; i < p.chunk_count; i++) {
+        p.chunks[i].in_string = in_string;
+        in_string ^= p.chunks[i].out_string;
+    }
+    if (in_string)
+        goto done;
+
+    parallel_for(config.threads, p.chunk_count, pass_depth, &p);
+
+    for (size_t i = 0; i < p.chunk_count; i++) {
+        long change = p.chunks[i].depth;
+        p.chunks[i].depth = depth;
+        depth += change;
+    }
+    if (depth != 0)
+        goto done;
+
+    parallel_for(config.threads, p.chunk_count, pass_split, &p);
+
+    if (!split_root(&p))
+        goto done;
+
+    parallel_for(config.threads, p.range_count, pass_parse, &p);
+
+    ok = true;
+    for (size_t i = 0; i < p.range_count; i++) {
+        ok &= !p.ranges[i].failed;
+        total += p.ranges[i].count;
+    }
+
+    if (ok) {
+        if (p.is_obj) {
+            *out = JSON_OBJECT;
+            ok = jsonext_obj_reserve(out, total);
+        } else {
+            *out = json_create_arr(total);
+        }
+        for (size_t i = 0; ok && i < p.range_count; i++) {
+            struct parallel_range_t *r = &p.ranges[i];
+            for (size_t k = 0; k < r->count; k++) {
+                if (p.is_obj)
+                    ok &= obj_emplace(out, r->members[k].key, r->members[k].container);
+                else
+                    json_append_value_p(out, &r->members[k].container);
+            }
+            r->count = 0;
+        }
+        // out of memory, the calling thread parses again and reports it
+        if (!ok)
+            json_clean(out);
+    }
+
+done:
+    for (size_t i = 0; i < p.range_count; i++) {
+        for (size_t k = 0; k < p.ranges[i].count; k++) {
+            json_free(p.ranges[i].members[k].key);
+            json_clean(&p.ranges[i].members[k].container);
+        }
+        free(p.ranges[i].members);
+    }
+    free(p.ranges);
+    free(p.chunks);
+    free(p.index);
+    return ok;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Parallel Parser
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON Validator
+// --------------------------------------------------
+
+/* What the validator accepts next */
+enum json_validate_state_t {
+    JVS_VALUE,       /* at the start, after ':' or after ',' in an array */
+    JVS_FIRST_VALUE, /* after '[' */
+    JVS_KEY,         /* after ',' in an object */
+    JVS_FIRST_KEY,   /* after '{' */
+    JVS_COLON,       /* after a key */
+    JVS_NEXT,        /* after a value inside a container */
+    JVS_DONE,        /* after the root value */
+};
+
+/*
+ * Check the grammar, escapes and UTF-8 of buf[0..len) token by token,
+ * without a token list or a tree. The open containers are kept as one bit
+ * per level, so memory stays constant up to JSON_MAX_DEPTH levels.
+ */
+struct json_error_t json_validate(const char *buf, size_t len) {
+    struct json_lexer_context_t lexer;
+    struct json_lexer_token_t token;
+    struct json_error_t error = {.code = JSON_ERROR_NONE};
+    uint64_t is_obj[JSON_MAX_DEPTH / 64]; // bit per open container, set for objects
+    size_t depth = 0;
+    enum json_validate_state_t state = JVS_VALUE;
+
+    init_lexer(&lexer, buf, len);
+    // the lexer checks the UTF-8 of every string
+    lexer.validate_utf8 = true;
+
+    while (!error.code && lex_next_token(&lexer, &token)) {
+        bool value = state == JVS_VALUE || state == JVS_FIRST_VALUE;
+        bool in_obj = depth && (is_obj[(depth - 1) / 64] >> ((depth - 1) % 64) & 1);
+
+        switch (token.type) {
+        case JLT_LPAIR:
+        case JLT_LARRAY:
+            if (!value)
+                break;
+            if (depth == JSON_MAX_DEPTH) {
+                set_error(&error, JSON_ERROR_DEPTH, token.start);
+                continue;
+            }
+            if (token.type == JLT_LPAIR)
+                is_obj[depth / 64] |= 1ULL << (depth % 64);
+            else
+                is_obj[depth / 64] &= ~(1ULL << (depth % 64));
+            depth++;
+            state = token.type == JLT_LPAIR ? JVS_FIRST_KEY : JVS_FIRST_VALUE;
+            continue;
+        case JLT_RPAIR:
+        case JLT_RARRAY:
+            if (!depth || in_obj != (token.type == JLT_RPAIR))
+                break;
+            if (state != JVS_NEXT && state != (in_obj ? JVS_FIRST_KEY : JVS_FIRST_VALUE))
+                break;
+            depth--;
+            state = depth ? JVS_NEXT : JVS_DONE;
+            continue;
+        case JLT_COMMA:
+            if (state != JVS_NEXT)
+                break;
+            state = in_obj ? JVS_KEY : JVS_VALUE;
+            continue;
+        case JLT_COLON:
+            if (state != JVS_COLON)
+                break;
+            state = JVS_VALUE;
+            continue;
+        case JLT_STRING: {
+            bool key = state == JVS_KEY || state == JVS_FIRST_KEY;
+
+            if (!key && !value)
+                break;
+            if (!check_escapes(token.text, token.end - token.start)) {
+                set_error(&error, JSON_ERROR_INVALID_ESCAPE, token_offset(&token));
+                continue;
+            }
+            state = key ? JVS_COLON : depth ? JVS_NEXT : JVS_DONE;
+            continue;
+        }
+        case JLT_NUMBER:
+            if (!value)
+                break;
+            if (!is_number(token.text, token.end - token.start)) {
+                set_error(&error, JSON_ERROR_INVALID_NUMBER, token.start);
+                continue;
+            }
+            state = depth ? JVS_NEXT : JVS_DONE;
+            continue;
+        default: // true, false, null
+            if (!value)
+                break;
+            state = depth ? JVS_NEXT : JVS_DONE;
+            continue;
+        }
+
+        // the token does not fit the grammar here
+        set_error(&error, state == JVS_DONE ? JSON_ERROR_TRAILING_DATA : JSON_ERROR_UNEXPECTED_TOKEN,
+                  token_offset(&token));
+    }
+
+    if (!error.code && lexer.error.code)
+        error = lexer.error;
+    else if (!error.code && state != JVS_DONE)
+        set_error(&error, JSON_ERROR_UNEXPECTED_EOF, len);
+
+    if (error.code) {
+        error.row = 1;
+        error.column = 1;
+        advance_position(buf, 0, error.offset, &error.row, &error.column);
+    }
+
+    return error;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Validator
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON Stream
+// --------------------------------------------------
+
+struct json_stream_t *__json_stream_new(struct json_stream_config config) {
+    struct json_stream_t *s = (struct json_stream_t *)calloc(1, sizeof(struct json_stream_t));
+    if (!s) {
+        JSON_LOG_ERROR("Memory allocation failed");
+        return NULL;
+    }
+
+    s->config = config;
+    s->row = 1;
+    s->column = 1;
+    s->state = JSS_ROOT;
+    s->parser.config = (struct json_parse_config){
+        .typed_numbers = config.typed_numbers,
+        .max_depth = config.max_depth,
+        .validate_utf8 = config.validate_utf8,
+    };
+    s->parser.lexer = &s->lexer;
+    s->parser.on_demand = true;
+    init_lexer(&s->lexer, NULL, 0);
+    s->lexer.validate_utf8 = config.validate_utf8;
+    return s;
+}
+
+void json_stream_free(struct json_stream_t *s) {
+    if (!s)
+        return;
+    for (; s->depth > 0; s->depth--) {
+        json_free(s->frames[s->depth - 1].key);
+        json_clean(&s->frames[s->depth - 1].container);
+    }
+    members_drop(&s->members, 0);
+    free(s->members.pairs);
+    free(s->frames);
+    free(s->buf);
+    free(s);
+}
+
+/* State after a root value, a sequence goes on with the next root. */
+static enum json_stream_state_t stream_root_done(struct json_stream_t *s) {
+    s->elements = false;
+    return s->config.sequence ? JSS_ROOT : JSS_DONE;
+}
+
+static void stream_error(struct json_stream_t *s, enum json_error_code code, size_t index) {
+    set_error(&s->error, code, s->offset + index);
+    s->error.row = s->row;
+    s->error.column = s->column;
+    advance_position(s->buf, 0, index, &s->error.row, &s->error.column);
+}
+
+/* Stop on the error the lexer or the parser rules recorded. */
+static void stream_fail(struct json_stream_t *s) {
+    struct json_error_t *error = s->lexer.error.code ? &s->lexer.error : &s->parser.error;
+    stream_error(s, error->code, error->offset);
+}
+
+/* Store a completed value in the open container, or emit it. */
+static void stream_value(struct json_stream_t *s, union json_t value) {
+    if (!s->depth) {
+        s->state = s->elements ? JSS_NEXT : stream_root_done(s);
+        if (s->config.callback)
+            s->config.callback(value, s->config.args);
+        else
+            json_clean(&value);
+        return;
+    }
+
+    struct json_parse_frame_t *top = &s->frames[s->depth - 1];
+    s->state = JSS_NEXT;
+
+    if (top->container.type == JT_OBJECT) {
+        char *key = top->key;
+        top->key = NULL;
+        if (!members_push(&s->parser, &s->members, key, value))
+            stream_fail(s);
+    } else {
+        json_append_value_p(&top->container, &value);
+    }
+}
+
+static void stream_open(struct json_stream_t *s, bool is_obj) {
+    size_t max_depth = s->config.max_depth ? s->config.max_depth : JSON_MAX_DEPTH;
+
+    if (s->state == JSS_ROOT && !is_obj && s->config.elements) {
+        s->elements = true;
+        s->state = JSS_FIRST_VALUE;
+        return;
+    }
+
+    // the root array of elements mode counts as a level
+    if (s->depth + s->elements == max_depth) {
+        parser_error(&s->parser, JSON_ERROR_DEPTH, current_token(&s->parser)->start);
+        stream_fail(s);
+        return;
+    }
+
+    if (s->depth == s->frames_capacity) {
+        size_t capacity = s->frames_capacity ? 2 * s->frames_capacity : 32;
+        struct json_parse_frame_t *grown =
+            (struct json_parse_frame_t *)realloc(s->frames, capacity * sizeof(struct json_parse_frame_t));
+        if (!grown) {
+            parser_error(&s->parser, JSON_ERROR_NO_MEMORY, current_token(&s->parser)->start);
+            stream_fail(s);
+            return;
+        }
+        s->frames = grown;
+        s->frames_capacity = capacity;
+    }
+
+    s->frames[s->depth++] = (struct json_parse_frame_t){
+        .container = is_obj ? JSON_OBJECT : JSON_ARRAY,
+        .key = NULL,
+        .first = s->members.length,
+    };
+    s->state = is_obj ? JSS_FIRST_KEY : JSS_FIRST_VALUE;
+}
+
+static void stream_close(struct json_stream_t *s) {
+    if (!s->depth) {
+        s->state = stream_root_done(s);
+        return;
+    }
+
+    struct json_parse_frame_t *top = &s->frames[--s->depth];
+    union json_t value =
+        top->container.type == JT_OBJECT ? members_build(&s->parser, &s->members, top->first) : top->container;
+
+    if (s->parser.error.code) {
+        stream_fail(s);
+        return;
+    }
+    stream_value(s, value);
+}
+
+/* Feed the lexed token in s->parser's lookahead slot to the grammar. */
+static void stream_token(struct json_stream_t *s) {
+    struct json_parser_context_t *ctx = &s->parser;
+    enum json_lexer_token_type_t t = ctx->lookahead.type;
+    bool in_obj = s->depth && s->frames[s->depth - 1].container.type == JT_OBJECT;
+    bool ok = true;
+    char *key;
+
+    switch (s->state) {
+    case JSS_FIRST_KEY:
+        if (t == JLT_RPAIR) {
+            match_token(ctx, JLT_RPAIR);
+            stream_close(s);
+            return;
+        }
+        // fall through
+    case JSS_KEY:
+        if ((ok = match_token(ctx, JLT_STRING)) && (ok = (key = token_string(ctx, current_token(ctx))) != NULL)) {
+            s->frames[s->depth - 1].key = key;
+            s->state = JSS_COLON;
+        }
+        break;
+    case JSS_COLON:
+        if ((ok = match_token(ctx, JLT_COLON)))
+            s->state = JSS_VALUE;
+        break;
+    case JSS_NEXT:
+        if (t == JLT_COMMA) {
+            match_token(ctx, JLT_COMMA);
+            s->state = in_obj ? JSS_KEY : JSS_VALUE;
+        } else if ((ok = match_token(ctx, in_obj ? JLT_RPAIR : JLT_RARRAY))) {
+            stream_close(s);
+        }
+        break;
+    case JSS_FIRST_VALUE:
+        if (t == JLT_RARRAY) {
+            match_token(ctx, JLT_RARRAY);
+            stream_close(s);
+            return;
+        }
+        // fall through
+    case JSS_ROOT:
+    case JSS_VALUE:
+        if (t == JLT_LPAIR || t == JLT_LARRAY) {
+            match_token(ctx, t);
+            stream_open(s, t == JLT_LPAIR);
+        } else {
+            union json_t value = scalar_rule(ctx);
+            if ((ok = !ctx->error.code))
+                stream_value(s, value);
+        }
+        break;
+    case JSS_DONE:
+        parser_error(ctx, JSON_ERROR_TRAILING_DATA, token_offset(&ctx->lookahead));
+        ok = false;
+        break;
+    }
+
+    if (!ok)
+        stream_fail(s);
+}
+
+/* A byte that cannot continue a number or literal */
+static bool is_delimiter(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',' || c == ':' || c == '[' || c == ']' ||
+           c == '{' || c == '}' || c == '"' || c == JSON_RS;
+}
+
+/*
+ * True once the string opening at buf[start] is closed in the buffer. The
+ * body is scanned from where the previous chunk left off, never from inside
+ * an escape, with the same vector kernels as the lexer.
+ */
+static bool stream_string_closed(struct json_stream_t *s, size_t start) {
+    size_t pos = s->string_scan ? s->string_scan : start + 1;
+
+    for (;;) {
+        pos += json_scan_string((const uint8_t *)s->buf + pos, s->len - pos);
+        if (pos == s->len || (s->buf[pos] == '\\' && pos + 1 == s->len)) {
+            s->string_scan = pos;
+            return false;
+        }
+        if (s->buf[pos] != '\\')
+            break;
+        pos += 2;
+    }
+
+    // a closing quote, or a control character the lexer reports
+    s->string_scan = 0;
+    return true;
+}
+
+/*
+ * Lex and parse every whole token in the buffer. A token that may go on in
+ * the next chunk is left at s->scan, unless this is the last chunk.
+ */
+static void stream_parse(struct json_stream_t *s, bool last) {
+    struct json_lexer_context_t *lexer = &s->lexer;
+    struct json_lexer_token_t token;
+
+    lexer->from_string = s->buf;
+    lexer->from_string_len = s->len;
+
+    while (!s->error.code) {
+        size_t i = s->scan;
+
+        while (i < s->len && (class_at(lexer, i) == JCC_SPACE ||
+                              (s->buf[i] == JSON_RS && s->config.sequence && s->state == JSS_ROOT)))
+            i++;
+        s->scan = i;
+        if (i == s->len)
+            break;
+
+        if (s->state == JSS_DONE) {
+            stream_error(s, JSON_ERROR_TRAILING_DATA, i);
+            break;
+        }
+
+        enum json_char_class_t c = class_at(lexer, i);
+        bool bare = c == JCC_NUMBER || c == JCC_TRUE || c == JCC_FALSE || c == JCC_NULL;
+
+        if (c == JCC_QUOTE && s->string_scan) {
+            // still cut, which at the end of the input is an EOF error
+            if (!stream_string_closed(s, i))
+                break;
+        } else if (bare) {
+            size_t end = i;
+            while (end < s->len && !is_delimiter(s->buf[end]))
+                end++;
+            if (end == s->len && !last)
+                break;
+        }
+
+        lexer->offset = i;
+        lexer->error = (struct json_error_t){.code = JSON_ERROR_NONE};
+        lex_token_at(lexer, &token);
+        if (lexer->error.code) {
+            // an unterminated string runs to the end of the buffer, wait for its end
+            if (c == JCC_QUOTE && lexer->error.offset == s->len && !stream_string_closed(s, i))
+                break;
+            stream_fail(s);
+            break;
+        }
+        // a byte glued to a number or literal is an error before the value is taken
+        if (bare && lexer->offset < s->len && !is_delimiter(s->buf[lexer->offset])) {
+            stream_error(s, JSON_ERROR_INVALID_CHAR, lexer->offset);
+            break;
+        }
+
+        s->scan = lexer->offset;
+        s->parser.lookahead = token;
+        s->parser.has_lookahead = true;
+        stream_token(s);
+    }
+}
+
+/* Drop the bytes before the pending token, keeping the position of buf[0]. */
+static void stream_compact(struct json_stream_t *s) {
+    size_t keep = s->scan;
+
+    if (!keep)
+        return;
+
+    advance_position(s->buf, 0, keep, &s->row, &s->column);
+    memmove(s->buf, s->buf + keep, s->len - keep);
+    s->offset += keep;
+    s->len -= keep;
+    s->scan = 0;
+    if (s->string_scan)
+        s->string_scan -= keep;
+}
+
+enum json_error_code json_stream_feed(struct json_stream_t *s, const char *buf, size_t len) {
+    if (s->error.code || !len)
+        return s->error.code;
+
+    if (s->len + len > s->capacity) {
+        size_t capacity = s->capacity ? s->capacity : JSON_STREAM_CHUNK;
+        while (capacity < s->len + len)
+            capacity *= 2;
+        char *grown = (char *)realloc(s->buf, capacity);
+        if (!grown) {
+            stream_error(s, JSON_ERROR_NO_MEMORY, s->len);
+            return s->error.code;
+        }
+        s->buf = grown;
+        s->capacity = capacity;
+    }
+
+    memcpy(s->buf + s->len, buf, len);
+    s->len += len;
+
+    stream_parse(s, false);
+    if (!s->error.code)
+        stream_compact(s);
+
+    return s->error.code;
+}
+
+enum json_error_code json_stream_finish(struct json_stream_t *s) {
+    if (s->error.code)
+        return s->error.code;
+
+    // a number or literal at the very end has no delimiter after it
+    stream_parse(s, true);
+
+    if (!s->error.code && s->state != JSS_DONE && !(s->config.sequence && s->state == JSS_ROOT))
+        stream_error(s, JSON_ERROR_UNEXPECTED_EOF, s->len);
+
+    return s->error.code;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Stream
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON Sequence
+// --------------------------------------------------
+
+struct json_seq_t *__json_seq_new(const char *buf, size_t len, struct json_parse_config config) {
+    struct json_seq_t *seq = (struct json_seq_t *)calloc(1, sizeof(struct json_seq_t));
+    if (!seq) {
+        JSON_LOG_ERROR("Memory allocation failed");
+        return NULL;
+    }
+
+    if (config.in_situ && !config.doc) {
+        JSON_LOG_WARNING("In-situ parsing needs a document, copying strings instead");
+        config.in_situ = false;
+    }
+
+    init_lexer(&seq->lexer, buf, len);
+    seq->lexer.validate_utf8 = config.validate_utf8;
+    seq->parser = (struct json_parser_context_t){
+        .config = config,
+        .lexer = &seq->lexer,
+        .on_demand = true,
+        .error = {.code = JSON_ERROR_NONE},
+    };
+    seq->buf = buf;
+    seq->len = len;
+    seq->row = 1;
+    seq->column = 1;
+
+    size_t i = 0;
+    while (i < len && (buf[i] == ' ' || buf[i] == '\t' || buf[i] == '\n' || buf[i] == '\r'))
+        i++;
+    if (i < len && buf[i] == JSON_RS) {
+        seq->records = true;
+        seq->next_record = i;
+    }
+
+    return seq;
+}
+
+void json_seq_free(struct json_seq_t *seq) { free(seq); }
+
+/* Record the parser error, counting row and column on from the last error. */
+static void seq_error(struct json_seq_t *seq) {
+    struct json_error_t *error = seq->parser.config.error;
+
+    seq->error = seq->parser.error;
+    advance_position(seq->buf, seq->position, seq->error.offset, &seq->row, &seq->column);
+    seq->position = seq->error.offset;
+    seq->error.row = seq->row;
+    seq->error.column = seq->column;
+
+    if (error)
+        *error = seq->error;
+}
+
+/* Point the lexer at the next non-empty record. Return false after the last one. */
+static bool seq_next_record(struct json_seq_t *seq) {
+    struct json_parser_context_t *parser = &seq->parser;
+
+    while (seq->next_record < seq->len) {
+        size_t start = seq->next_record + 1;
+        const char *rs = (const char *)memchr(seq->buf + start, JSON_RS, seq->len - start);
+        size_t end = rs ? (size_t)(rs - seq->buf) : seq->len;
+
+        seq->next_record = end;
+        seek_lexer(&seq->lexer, start, end);
+        parser->has_lookahead = false;
+        parser->error = (struct json_error_t){.code = JSON_ERROR_NONE};
+
+        // consecutive separators do not make empty records
+        if (!at_end(parser) || seq->lexer.error.code)
+            return true;
+    }
+
+    return false;
+}
+
+bool json_seq_next(struct json_seq_t *seq, union json_t *value) {
+    struct json_parser_context_t *parser = &seq->parser;
+    struct json_doc_t *doc = parser->config.doc;
+
+    *value = JSON_MISSING;
+
+    if (seq->records) {
+        // a bad record is skipped, as RFC 7464 asks
+        if (!seq_next_record(seq))
+            return false;
+        seq->error = (struct json_error_t){.code = JSON_ERROR_NONE};
+    } else if (seq->error.code) {
+        // without separators there is no telling where the next value starts
+        return false;
+    } else if (at_end(parser)) {
+        if (seq->lexer.error.code) {
+            unexpected_token(parser, JSON_ERROR_UNEXPECTED_TOKEN);
+            seq_error(seq);
+        }
+        return false;
+    }
+
+    if (doc)
+        json_doc_begin(doc);
+    parser->root = parse_iterative(parser);
+    // a record holds exactly one value
+    if (seq->records)
+        parse_end(parser);
+    if (doc)
+        json_doc_end(doc);
+
+    if (parser->error.code) {
+        seq_error(seq);
+        return false;
+    }
+
+    *value = parser->root;
+    seq->count++;
+    return true;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Sequence
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON Index
+// --------------------------------------------------
+
+/* Hash 8 bytes at a time, for the source checksum and the object keys. */
+static uint64_t hash_bytes(const char *p, size_t len) {
+    const uint64_t k = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = len * k, w = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * k;
+        h ^= h >> 32;
+    }
+
+    w = 0;
+    memcpy(&w, p + i, len - i);
+    h = (h ^ w) * k;
+    return h ^ (h >> 29);
+}
+
+/* Match the tokens of one value without building it. */
+static bool skip_value(struct json_parser_context_t *ctx) {
+    size_t depth = 0;
+
+    do {
+        enum json_lexer_token_type_t t = fill_lookahead(ctx)->type;
+
+        if (t == JLT_LPAIR || t == JLT_LARRAY)
+            depth++;
+        else if (t == JLT_RPAIR || t == JLT_RARRAY)
+            depth--;
+        if (!match_token(ctx, t) || t == JLT_MISSING)
+            return false;
+    } while (depth);
+
+    return true;
+}
+
+bool json_index_build(const char *file_path, const char *index_path) {
+    struct json_index_header_t header = {.magic = {0}, .version = JSON_INDEX_VERSION};
+    struct json_lexer_context_t lexer;
+    struct json_parser_context_t parser = {.lexer = &lexer, .on_demand = true, .error = {.code = JSON_ERROR_NONE}};
+    uint64_t *ends = NULL, *hashes = NULL;
+    size_t len = 0, capacity = 0;
+    struct json_error_t error;
+    struct stat st;
+    bool ok = false;
+    FILE *out = NULL;
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        JSON_LOG_WARNING("Could not open file: %s", file_path);
+        return false;
+    }
+
+    char *map = map_file(fd, &len, false);
+    if (!map || fstat(fd, &st) != 0) {
+        JSON_LOG_WARNING("Only non-empty regular files can be indexed: %s", file_path);
+        goto done;
+    }
+
+    error = json_validate(map, len);
+    if (error.code) {
+        JSON_LOG_WARNING("Invalid JSON at offset %zu: %s", error.offset, json_error2str(error.code));
+        goto done;
+    }
+
+    init_lexer(&lexer, map, len);
+    header.is_obj = lookahead_token(&parser, JLT_LPAIR);
+    if (!header.is_obj && !lookahead_token(&parser, JLT_LARRAY)) {
+        JSON_LOG_WARNING("Only an array or object root can be indexed: %s", file_path);
+        goto done;
+    }
+    header.root = token_offset(fill_lookahead(&parser));
+    match_token(&parser, fill_lookahead(&parser)->type);
+
+    if (!lookahead_token(&parser, header.is_obj ? JLT_RPAIR : JLT_RARRAY)) {
+        do {
+            uint64_t hash = 0;
+
+            if (header.is_obj) {
+                char *key = key_rule(&parser);
+                if (!key)
+                    goto done;
+                hash = hash_bytes(key, strlen(key));
+                json_free(key);
+            }
+            if (!skip_value(&parser))
+                goto done;
+
+            if (header.count == capacity) {
+                capacity = capacity ? 2 * capacity : 1024;
+                uint64_t *grown = (uint64_t *)realloc(ends, capacity * sizeof(uint64_t));
+                if (!grown) {
+                    JSON_LOG_ERROR("Memory allocation failed");
+                    goto done;
+                }
+                ends = grown;
+                grown = (uint64_t *)realloc(hashes, capacity * sizeof(uint64_t));
+                if (!grown) {
+                    JSON_LOG_ERROR("Memory allocation failed");
+                    goto done;
+                }
+                hashes = grown;
+            }
+            // the comma or bracket after the member
+            ends[header.count] = token_offset(fill_lookahead(&parser));
+            hashes[header.count++] = hash;
+        } while (lookahead_token(&parser, JLT_COMMA) && match_token(&parser, JLT_COMMA));
+    }
+
+    memcpy(header.magic, JSON_INDEX_MAGIC, sizeof(header.magic));
+    header.source_size = len;
+    header.source_mtime_sec = st.st_mtim.tv_sec;
+    header.source_mtime_nsec = st.st_mtim.tv_nsec;
+    header.checksum = hash_bytes(map, len);
+
+    out = fopen(index_path, "wb");
+    if (!out) {
+        JSON_LOG_WARNING("Could not open file: %s", index_path);
+        goto done;
+    }
+    ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+         (!header.count || fwrite(ends, sizeof(uint64_t), header.count, out) == header.count) &&
+         (!header.count || !header.is_obj || fwrite(hashes, sizeof(uint64_t), header.count, out) == header.count);
+    ok &= fclose(out) == 0;
+    if (!ok)
+        JSON_LOG_WARNING("Could not write file: %s", index_path);
+
+done:
+    free(ends);
+    free(hashes);
+    if (map)
+        munmap(map, len);
+    close(fd);
+    return ok;
+}
+
+/* Map a whole file read only. Return NULL if it cannot be opened or mapped. */
+static char *map_path(const char *path, size_t *len, struct stat *st) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        JSON_LOG_WARNING("Could not open file: %s", path);
+        return NULL;
+    }
+
+    char *map = map_file(fd, len, false);
+    if (map && fstat(fd, st) != 0) {
+        munmap(map, *len);
+        map = NULL;
+    }
+
+    close(fd);
+    return map;
+}
+
+struct json_index_t *json_index_open(const char *file_path, const char *index_path, bool verify) {
+    struct json_index_t *idx = (struct json_index_t *)calloc(1, sizeof(struct json_index_t));
+    const struct json_index_header_t *h;
+    struct stat source_st, index_st;
+    size_t entries;
+
+    if (!idx) {
+        JSON_LOG_ERROR("Memory allocation failed");
+        return NULL;
+    }
+
+    idx->source = map_path(file_path, &idx->source_len, &source_st);
+    idx->header = h = (const struct json_index_header_t *)map_path(index_path, &idx->index_len, &index_st);
+    if (!idx->source || !h)
+        goto fail;
+
+    // members are read in any order, not front to back
+    posix_madvise((void *)idx->source, idx->source_len, POSIX_MADV_RANDOM);
+
+    if (idx->index_len < sizeof(*h) || memcmp(h->magic, JSON_INDEX_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != JSON_INDEX_VERSION) {
+        JSON_LOG_WARNING("Not an index file: %s", index_path);
+        goto fail;
+    }
+
+    entries = (idx->index_len - sizeof(*h)) / sizeof(uint64_t);
+    if (entries != (h->is_obj ? 2 : 1) * h->count || h->root >= idx->source_len) {
+        JSON_LOG_WARNING("Truncated index file: %s", index_path);
+        goto fail;
+    }
+
+    if (h->source_size != (uint64_t)source_st.st_size || h->source_mtime_sec != source_st.st_mtim.tv_sec ||
+        h->source_mtime_nsec != source_st.st_mtim.tv_nsec ||
+        (verify && h->checksum != hash_bytes(idx->source, idx->source_len))) {
+        JSON_LOG_WARNING("Index does not match file: %s", file_path);
+        goto fail;
+    }
+
+    idx->count = h->count;
+    idx->ends = (const uint64_t *)(h + 1);
+    idx->hashes = h->is_obj ? idx->ends + h->count : NULL;
+    return idx;
+
+fail:
+    json_index_close(idx);
+    return NULL;
+}
+
+void json_index_close(struct json_index_t *idx) {
+    if (!idx)
+        return;
+    if (idx->source)
+        munmap((void *)idx->source, idx->source_len);
+    if (idx->header)
+        munmap((void *)idx->header, idx->index_len);
+    free(idx);
+}
+
+/*
+ * Parse member i into *out. For objects, return false if its key is not
+ * `key`, unless key is NULL. Error offsets count from the start of the file,
+ * row and column from the start of the member.
+ */
+static bool index_member(struct json_index_t *idx, size_t i, const char *key, struct json_parse_config config,
+                         union json_t *out) {
+    size_t start = i ? idx->ends[i - 1] + 1 : idx->header->root + 1;
+    size_t end = idx->ends[i];
+    struct json_lexer_context_t lexer;
+    struct json_parser_context_t parser = {.lexer = &lexer, .on_demand = true, .error = {.code = JSON_ERROR_NONE}};
+
+    // the mapping is read only
+    config.in_situ = false;
+
+    if (!idx->hashes) {
+        *out = __json_deserialize_n_with(idx->source + start, end - start, config);
+        if (config.error && config.error->code)
+            config.error->offset += start;
+        return true;
+    }
+
+    init_lexer(&lexer, idx->source + start, end - start);
+    lexer.validate_utf8 = config.validate_utf8;
+    parser.config = config;
+
+    char *k = key_rule(&parser);
+    bool match = k && (!key || strcmp(k, key) == 0);
+    json_free(k);
+    if (!match)
+        return false;
+
+    if (config.doc)
+        json_doc_begin(config.doc);
+    parser.root = parse_iterative(&parser);
+    parse_end(&parser);
+    if (config.doc)
+        json_doc_end(config.doc);
+
+    report_error(config.error, lexer.from_string, parser.error);
+    if (config.error && config.error->code)
+        config.error->offset += start;
+
+    *out = parser.root;
+    return true;
+}
+
+union json_t __json_index_get(struct json_index_t *idx, size_t i, struct json_parse_config config) {
+    union json_t j = JSON_MISSING;
+
+    if (i < idx->count)
+        index_member(idx, i, NULL, config, &j);
+    return j;
+}
+
+union json_t __json_index_get_key(struct json_index_t *idx, const char *key, struct json_parse_config config) {
+    union json_t j = JSON_MISSING;
+
+    if (!idx->hashes)
+        return j;
+
+    // the last of repeated keys wins, as in a full parse
+    uint64_t hash = hash_bytes(key, strlen(key));
+    for (size_t i = idx->count; i-- > 0;) {
+        if (idx->hashes[i] == hash && index_member(idx, i, key, config, &j))
+            break;
+    }
+    return j;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Index
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON Pointer
+// --------------------------------------------------
+
+/* One reference token of the requested pointers, with the tokens that may follow it. */
+struct pointer_node_t {
+    char *token; /* unescaped, NULL for the root */
+    size_t len;
+    size_t index; /* as an array index, SIZE_MAX if it is not one */
+    bool whole;   /* a pointer ends here, so the value is parsed whole */
+    struct pointer_node_t *children;
+    size_t count;
+};
+
+static void free_pointer_node(struct pointer_node_t *node) {
+    for (size_t i = 0; i < node->count; i++)
+        free_pointer_node(&node->children[i]);
+    free(node->children);
+    free(node->token);
+}
+
+/* An array index is "0" or a decimal number without leading zeros. */
+static size_t pointer_index(const char *token, size_t len) {
+    size_t index = 0;
+
+    if (len == 0 || len > 18 || (token[0] == '0' && len > 1))
+        return SIZE_MAX;
+    for (size_t i = 0; i < len; i++) {
+        if (token[i] < '0' || token[i] > '9')
+            return SIZE_MAX;
+        index = index * 10 + (token[i] - '0');
+    }
+    return index;
+}
+
+/* Return the child for the raw reference token p[0..len), added if new. NULL if out of memory. */
+static struct pointer_node_t *pointer_child(struct pointer_node_t *node, const char *p, size_t len) {
+    char *token = (char *)malloc(len + 1);
+    size_t n = 0;
+
+    if (!token) {
+        JSON_LOG_ERROR("Memory allocation failed");
+        return NULL;
+    }
+
+    // ~1 is '/' and ~0 is '~', in this order so "~01" stays "~1"
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] == '~' && i + 1 < len && (p[i + 1] == '0' || p[i + 1] == '1'))
+            token[n++] = p[++i] == '0' ? '~' : '/';
+        else
+            token[n++] = p[i];
+    }
+    token[n] = '\0';
+
+    for (size_t i = 0; i < node->count; i++) {
+        if (node->children[i].len == n && memcmp(node->children[i].token, token, n) == 0) {
+            free(token);
+            return &node->children[i];
+        }
+    }
+
+    struct pointer_node_t *grown =
+        (struct pointer_node_t *)realloc(node->children, (node->count + 1) * sizeof(struct pointer_node_t));
+    if (!grown) {
+        JSON_LOG_ERROR("Memory allocation failed");
+        free(token);
+        return NULL;
+    }
+    node->children = grown;
+    grown[node->count] = (struct pointer_node_t){
+        .token = token,
+        .len = n,
+        .index = pointer_index(token, n),
+        .whole = false,
+        .children = NULL,
+        .count = 0,
+    };
+    return &grown[node->count++];
+}
+
+/* Merge all pointers into one tree of reference tokens. Return false if out of memory. */
+static bool build_pointer_tree(struct pointer_node_t *root, const char *const *paths, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        struct pointer_node_t *node = root;
+        const char *p = paths[i];
+
+        if (*p && *p != '/') {
+            JSON_LOG_WARNING("Not a JSON Pointer: %s", p);
+            continue;
+        }
+
+        while (*p) {
+            const char *token = p + 1;
+            p = token + strcspn(token, "/");
+            if (!(node = pointer_child(node, token, p - token)))
+                return false;
+        }
+        node->whole = true;
+    }
+    return true;
+}
+
+/*
+ * Skip the rest of a container `depth` levels deep, up to and including its
+ * closing bracket. Only the structural index is read: strings are jumped
+ * over by their opening quote and scalars by their first byte.
+ */
+static bool skip_rest(struct json_parser_context_t *ctx, size_t depth) {
+    struct json_lexer_context_t *lexer = ctx->lexer;
+
+    // the token already lexed for lookahead
+    if (ctx->has_lookahead) {
+        enum json_lexer_token_type_t t = ctx->lookahead.type;
+
+        if (t == JLT_MISSING) {
+            unexpected_token(ctx, JSON_ERROR_UNEXPECTED_TOKEN);
+            return false;
+        }
+        ctx->has_lookahead = false;
+        if (t == JLT_LPAIR || t == JLT_LARRAY)
+            depth++;
+        else if ((t == JLT_RPAIR || t == JLT_RARRAY) && --depth == 0)
+            return true;
+    }
+
+    for (;;) {
+        size_t pos = next_structural(lexer);
+
+        if (pos >= lexer->from_string_len) {
+            parser_error(ctx, JSON_ERROR_UNEXPECTED_EOF, lexer->from_string_len);
+            return false;
+        }
+
+        lexer->offset = pos + 1;
+        switch (lexer->from_string[pos]) {
+        case '{': case '[': depth++; break;
+        case '}': case ']':
+            if (--depth == 0)
+                return true;
+            break;
+        default: break;
+        }
+    }
+}
+
+/* Skip one value without building it. */
+static bool skip_fast(struct json_parser_context_t *ctx) {
+    enum json_lexer_token_type_t t = fill_lookahead(ctx)->type;
+
+    switch (t) {
+    case JLT_LPAIR:
+    case JLT_LARRAY:
+        match_token(ctx, t);
+        return skip_rest(ctx, 1);
+    case JLT_STRING:
+    case JLT_NUMBER:
+    case JLT_TRUE:
+    case JLT_FALSE:
+    case JLT_NULL:
+        return match_token(ctx, t);
+    default:
+        unexpected_token(ctx, JSON_ERROR_UNEXPECTED_TOKEN);
+        return false;
+    }
+}
+
+/* Return the child of node named by the key token, without copying keys that have no escapes. */
+static struct pointer_node_t *pointer_key(struct pointer_node_t *node, const struct json_lexer_token_t *token) {
+    const char *key = token->text;
+    size_t len = token->end - token->start;
+    char *decoded = NULL;
+    struct pointer_node_t *found = NULL;
+
+    if (memchr(key, '\\', len)) {
+        if (!(decoded = (char *)malloc(len + 1)))
+            return NULL;
+        len = unescape_string(decoded, key, len);
+        key = decoded;
+    }
+
+    for (size_t i = 0; len != SIZE_MAX && i < node->count && !found; i++) {
+        if (node->children[i].len == len && memcmp(node->children[i].token, key, len) == 0)
+            found = &node->children[i];
+    }
+
+    free(decoded);
+    return found;
+}
+
+static union json_t select_value(struct json_parser_context_t *ctx, struct pointer_node_t *node);
+
+static union json_t select_object(struct json_parser_context_t *ctx, struct pointer_node_t *node) {
+    size_t first = ctx->members.length;
+    struct json_lexer_token_t key_token;
+    struct pointer_node_t *child;
+    union json_t value;
+    char *key;
+
+    match_token(ctx, JLT_LPAIR);
+
+    if (lookahead_token(ctx, JLT_RPAIR)) {
+        match_token(ctx, JLT_RPAIR);
+        return JSON_OBJECT;
+    }
+
+    do {
+        if (!match_token(ctx, JLT_STRING))
+            break;
+        key_token = *current_token(ctx);
+        if (!match_token(ctx, JLT_COLON))
+            break;
+
+        if (!(child = pointer_key(node, &key_token))) {
+            if (!skip_fast(ctx))
+                break;
+            continue;
+        }
+
+        if (!(key = token_string(ctx, &key_token)))
+            break;
+        value = select_value(ctx, child);
+        if (ctx->error.code || value.type == JT_MISSING) {
+            json_free(key);
+            if (ctx->error.code)
+                break;
+            continue;
+        }
+        if (!members_push(ctx, &ctx->members, key, value))
+            break;
+    } while (lookahead_token(ctx, JLT_COMMA) && match_token(ctx, JLT_COMMA));
+
+    if (!ctx->error.code && match_token(ctx, JLT_RPAIR))
+        return members_build(ctx, &ctx->members, first);
+
+    members_drop(&ctx->members, first);
+    return JSON_MISSING;
+}
+
+static union json_t select_array(struct json_parser_context_t *ctx, struct pointer_node_t *node) {
+    union json_t jarr = JSON_ARRAY;
+    size_t last = 0, i = 0;
+    bool any = false;
+    union json_t value;
+
+    for (size_t k = 0; k < node->count; k++) {
+        if (node->children[k].index != SIZE_MAX && (!any || node->children[k].index > last)) {
+            last = node->children[k].index;
+            any = true;
+        }
+    }
+
+    match_token(ctx, JLT_LARRAY);
+
+    // no element is wanted
+    if (!any) {
+        if (skip_rest(ctx, 1))
+            return jarr;
+        return JSON_MISSING;
+    }
+
+    if (lookahead_token(ctx, JLT_RARRAY)) {
+        match_token(ctx, JLT_RARRAY);
+        return jarr;
+    }
+
+    do {
+        struct pointer_node_t *child = NULL;
+
+        for (size_t k = 0; k < node->count && !child; k++) {
+            if (node->children[k].index == i)
+                child = &node->children[k];
+        }
+
+        if (child) {
+            value = select_value(ctx, child);
+        } else {
+            skip_fast(ctx);
+            value = JSON_MISSING;
+        }
+        if (ctx->error.code)
+            break;
+
+        // holes keep the indexes of the selected elements
+        if (value.type == JT_MISSING)
+            value = JSON_NULL;
+        json_append_value_p(&jarr, &value);
+
+        if (i++ == last) {
+            if (skip_rest(ctx, 1))
+                return jarr;
+            break;
+        }
+    } while (lookahead_token(ctx, JLT_COMMA) && match_token(ctx, JLT_COMMA));
+
+    if (!ctx->error.code && match_token(ctx, JLT_RARRAY))
+        return jarr;
+
+    json_clean(&jarr);
+    return JSON_MISSING;
+}
+
+/* JSON_MISSING without an error if a pointer goes on through a scalar. */
+static union json_t select_value(struct json_parser_context_t *ctx, struct pointer_node_t *node) {
+    if (node->whole)
+        return parse_iterative(ctx);
+    if (lookahead_token(ctx, JLT_LPAIR))
+        return select_object(ctx, node);
+    if (lookahead_token(ctx, JLT_LARRAY))
+        return select_array(ctx, node);
+    skip_fast(ctx);
+    return JSON_MISSING;
+}
+
+union json_t __json_deserialize_paths(const char *input_text, size_t len, const char *const *paths, size_t count,
+                                      struct json_parse_config config) {
+    struct pointer_node_t root = {.token = NULL, .len = 0, .index = SIZE_MAX, .whole = false, .children = NULL,
+                                  .count = 0};
+    struct json_lexer_context_t lexer;
+    struct json_parser_context_t parser = {.lexer = &lexer, .on_demand = true, .error = {.code = JSON_ERROR_NONE}};
+
+    if (config.error)
+        *config.error = (struct json_error_t){.code = JSON_ERROR_NONE};
+
+    if (!build_pointer_tree(&root, paths, count)) {
+        free_pointer_node(&root);
+        return JSON_MISSING;
+    }
+
+    if (config.in_situ && !config.doc) {
+        JSON_LOG_WARNING("In-situ parsing needs a document, copying strings instead");
+        config.in_situ = false;
+    }
+
+    init_lexer(&lexer, input_text, len);
+    lexer.validate_utf8 = config.validate_utf8;
+    parser.config = config;
+
+    if (config.doc)
+        json_doc_begin(config.doc);
+    parser.root = select_value(&parser, &root);
+    parse_end(&parser);
+    if (config.doc)
+        json_doc_end(config.doc);
+
+    report_error(config.error, input_text, parser.error);
+    free_pointer_node(&root);
+    return parser.root;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Pointer
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON SAX
+// --------------------------------------------------
+
+/* State of one SAX parse. The container stack is one bit per level, set for objects. */
+struct sax_parse_t {
+    struct json_sax_config config;
+    struct json_parser_context_t parser;
+    uint64_t *stack;
+    char *scratch; /* decoded strings with escapes */
+    size_t scratch_len;
+    /* Mapped file whose pages before `released` have been dropped */
+    char *map;
+    size_t released;
+};
+
+/* Decode the current string token and pass it to cb. */
+static bool sax_string(struct sax_parse_t *sax, bool (*cb)(const char *, size_t, void *)) {
+    struct json_lexer_token_t *token = current_token(&sax->parser);
+    size_t len = token->end - token->start;
+    const char *text = token->text;
+
+    if (!cb)
+        return true;
+
+    if (memchr(text, '\\', len)) {
+        if (len > sax->scratch_len) {
+            char *grown = (char *)realloc(sax->scratch, len);
+            if (!grown) {
+                parser_error(&sax->parser, JSON_ERROR_NO_MEMORY, token_offset(token));
+                return false;
+            }
+            sax->scratch = grown;
+            sax->scratch_len = len;
+        }
+        len = unescape_string(sax->scratch, text, len);
+        if (len == SIZE_MAX) {
+            parser_error(&sax->parser, JSON_ERROR_INVALID_ESCAPE, token_offset(token));
+            return false;
+        }
+        text = sax->scratch;
+    }
+
+    if (!cb(text, len, sax->config.args)) {
+        parser_error(&sax->parser, JSON_ERROR_ABORTED, token_offset(token));
+        return false;
+    }
+    return true;
+}
+
+/* Report a scalar token, or return false on an error. */
+static bool sax_scalar(struct sax_parse_t *sax) {
+    struct json_parser_context_t *ctx = &sax->parser;
+    struct json_sax_config *c = &sax->config;
+    enum json_lexer_token_type_t t = fill_lookahead(ctx)->type;
+    struct json_lexer_token_t *token;
+    bool ok = true;
+
+    switch (t) {
+    case JLT_STRING:
+        match_token(ctx, t);
+        return sax_string(sax, c->string);
+    case JLT_NUMBER:
+        match_token(ctx, t);
+        token = current_token(ctx);
+        if (!is_number(token->text, token->end - token->start)) {
+            parser_error(ctx, JSON_ERROR_INVALID_NUMBER, token->start);
+            return false;
+        }
+        ok = !c->number || c->number(token->text, token->end - token->start, c->args);
+        break;
+    case JLT_TRUE:
+    case JLT_FALSE:
+        match_token(ctx, t);
+        ok = !c->boolean || c->boolean(t == JLT_TRUE, c->args);
+        break;
+    case JLT_NULL:
+        match_token(ctx, t);
+        ok = !c->null || c->null(c->args);
+        break;
+    default:
+        unexpected_token(ctx, JSON_ERROR_UNEXPECTED_TOKEN);
+        return false;
+    }
+
+    if (!ok)
+        parser_error(ctx, JSON_ERROR_ABORTED, current_token(ctx)->start);
+    return ok;
+}
+
+/* Match the opening or closing bracket `t` and report it. */
+static bool sax_bracket(struct sax_parse_t *sax, enum json_lexer_token_type_t t) {
+    struct json_sax_config *c = &sax->config;
+    bool (*cb)(void *) = t == JLT_LPAIR    ? c->start_object
+                         : t == JLT_RPAIR  ? c->end_object
+                         : t == JLT_LARRAY ? c->start_array
+                                           : c->end_array;
+
+    if (!match_token(&sax->parser, t))
+        return false;
+    if (cb && !cb(c->args)) {
+        parser_error(&sax->parser, JSON_ERROR_ABORTED, current_token(&sax->parser)->start);
+        return false;
+    }
+    return true;
+}
+
+/* Match `key :` and report the key. */
+static bool sax_key(struct sax_parse_t *sax) {
+    return match_token(&sax->parser, JLT_STRING) && sax_string(sax, sax->config.key) &&
+           match_token(&sax->parser, JLT_COLON);
+}
+
+/* Drop the pages of a mapped file that the lexer has moved past. */
+static void sax_release(struct sax_parse_t *sax) {
+    size_t offset = sax->parser.lexer->offset;
+
+    if (sax->map && offset - sax->released >= JSON_SAX_RELEASE) {
+        size_t end = offset - offset % (size_t)sysconf(_SC_PAGESIZE);
+        // the mapping is read only, so the pages are read from the file again if needed
+        madvise(sax->map + sax->released, end - sax->released, MADV_DONTNEED);
+        sax->released = end;
+    }
+}
+
+/* Same grammar and depth limit as parse_iterative, with events instead of a tree. */
+static void sax_run(struct sax_parse_t *sax) {
+    struct json_parser_context_t *ctx = &sax->parser;
+    size_t max_depth = sax->config.max_depth ? sax->config.max_depth : JSON_MAX_DEPTH;
+    size_t depth = 0;
+    bool is_obj;
+
+    sax->stack = (uint64_t *)calloc(max_depth / 64 + 1, sizeof(uint64_t));
+    if (!sax->stack) {
+        parser_error(ctx, JSON_ERROR_NO_MEMORY, 0);
+        return;
+    }
+
+    for (;;) {
+        /* Descend into a container, or report a scalar */
+        if (lookahead_token(ctx, JLT_LPAIR) || lookahead_token(ctx, JLT_LARRAY)) {
+            is_obj = lookahead_token(ctx, JLT_LPAIR);
+
+            if (depth == max_depth) {
+                parser_error(ctx, JSON_ERROR_DEPTH, token_offset(fill_lookahead(ctx)));
+                return;
+            }
+            if (!sax_bracket(sax, is_obj ? JLT_LPAIR : JLT_LARRAY))
+                return;
+
+            if (is_obj)
+                sax->stack[depth / 64] |= 1ULL << (depth % 64);
+            else
+                sax->stack[depth / 64] &= ~(1ULL << (depth % 64));
+            depth++;
+
+            if (!lookahead_token(ctx, is_obj ? JLT_RPAIR : JLT_RARRAY)) {
+                if (is_obj && !sax_key(sax))
+                    return;
+                continue;
+            }
+
+            if (!sax_bracket(sax, is_obj ? JLT_RPAIR : JLT_RARRAY))
+                return;
+            depth--;
+        } else if (!sax_scalar(sax)) {
+            return;
+        }
+
+        /* Ascend: close every container that ends here */
+        for (;;) {
+            if (depth == 0)
+                return;
+
+            sax_release(sax);
+            is_obj = sax->stack[(depth - 1) / 64] >> ((depth - 1) % 64) & 1;
+
+            if (lookahead_token(ctx, JLT_COMMA)) {
+                match_token(ctx, JLT_COMMA);
+                if (is_obj && !sax_key(sax))
+                    return;
+                break;
+            }
+
+            if (!sax_bracket(sax, is_obj ? JLT_RPAIR : JLT_RARRAY))
+                return;
+            depth--;
+        }
+    }
+}
+
+static struct json_error_t sax_parse(const char *buf, size_t len, struct json_sax_config config, char *map) {
+    struct json_lexer_context_t lexer;
+    struct sax_parse_t sax = {
+        .config = config,
+        .parser = {.lexer = &lexer, .on_demand = true, .error = {.code = JSON_ERROR_NONE}},
+        .stack = NULL,
+        .scratch = NULL,
+        .scratch_len = 0,
+        .map = map,
+        .released = 0,
+    };
+    struct json_error_t error;
+
+    init_lexer(&lexer, buf, len);
+    lexer.validate_utf8 = config.validate_utf8;
+    sax_run(&sax);
+    if (!sax.parser.error.code && (!at_end(&sax.parser) || lexer.error.code))
+        unexpected_token(&sax.parser, JSON_ERROR_TRAILING_DATA);
+
+    free(sax.stack);
+    free(sax.scratch);
+
+    report_error(&error, buf, sax.parser.error);
+    return error;
+}
+
+struct json_error_t __json_sax_parse(const char *buf, size_t len, struct json_sax_config config) {
+    return sax_parse(buf, len, config, NULL);
+}
+
+struct json_error_t __json_sax_file(const char *file_path, struct json_sax_config config) {
+    struct json_error_t error = {.code = JSON_ERROR_IO};
+    size_t len = 0, capacity = 0;
+    char *buf = NULL;
+    ssize_t n = 0;
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        JSON_LOG_WARNING("Could not open file: %s", file_path);
+        return error;
+    }
+
+    char *map = map_file(fd, &len, false);
+    if (map) {
+        error = sax_parse(map, len, config, map);
+        munmap(map, len);
+        close(fd);
+        return error;
+    }
+
+    // pipes and other files that cannot be mapped are read whole
+    do {
+        len += n;
+        if (len == capacity) {
+            capacity = capacity ? 2 * capacity : JSON_STREAM_CHUNK;
+            char *grown = (char *)realloc(buf, capacity);
+            if (!grown) {
+                JSON_LOG_ERROR("Memory allocation failed");
+                error.code = JSON_ERROR_NO_MEMORY;
+                free(buf);
+                close(fd);
+                return error;
+            }
+            buf = grown;
+        }
+    } while ((n = read(fd, buf + len, capacity - len)) > 0);
+
+    if (n == 0)
+        error = sax_parse(buf, len, config, NULL);
+    free(buf);
+    close(fd);
+    return error;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON SAX
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON Cursor
+// --------------------------------------------------
+
+struct json_cursor_t *__json_cursor_new(const char *buf, size_t len, struct json_parse_config config) {
+    struct json_cursor_t *c = (struct json_cursor_t *)calloc(1, sizeof(struct json_cursor_t));
+    struct json_cursor_frame_t *root = (struct json_cursor_frame_t *)malloc(sizeof(struct json_cursor_frame_t));
+
+    if (!c || !root) {
+        JSON_LOG_ERROR("Memory allocation failed");
+        free(c);
+        free(root);
+        return NULL;
+    }
+
+    // the buffer is read only
+    config.in_situ = false;
+
+    init_lexer(&c->lexer, buf, len);
+    c->lexer.validate_utf8 = config.validate_utf8;
+    c->parser = (struct json_parser_context_t){.lexer = &c->lexer, .on_demand = true, .error = {.code = JSON_ERROR_NONE}};
+    c->parser.config = config;
+    *root = (struct json_cursor_frame_t){.start = 0, .is_obj = false, .first = false, .pending = true};
+    c->frames = root;
+    c->capacity = 1;
+    return c;
+}
+
+void json_cursor_free(struct json_cursor_t *c) {
+    if (!c)
+        return;
+    free(c->frames);
+    free(c->scratch);
+    free(c);
+}
+
+/* Copy a new parser error out with its row and column, return ok unless there is an error. */
+static bool cursor_done(struct json_cursor_t *c, bool ok) {
+    if (c->parser.error.code && !c->error.code)
+        report_error(&c->error, c->lexer.from_string, c->parser.error);
+    return ok && !c->error.code;
+}
+
+static struct json_cursor_frame_t *cursor_top(struct json_cursor_t *c) { return &c->frames[c->depth]; }
+
+/* Decode text[0..len) of the string token at offset, into scratch if it has escapes. */
+static bool cursor_decode(struct json_cursor_t *c, const char *text, size_t len, size_t offset, const char **out,
+                          size_t *out_len) {
+    if (!memchr(text, '\\', len)) {
+        *out = text;
+        *out_len = len;
+        return true;
+    }
+
+    if (len > c->scratch_len) {
+        char *grown = (char *)realloc(c->scratch, len);
+        if (!grown) {
+            parser_error(&c->parser, JSON_ERROR_NO_MEMORY, offset);
+            return false;
+        }
+        c->scratch = grown;
+        c->scratch_len = len;
+    }
+
+    *out_len = unescape_string(c->scratch, text, len);
+    if (*out_len == SIZE_MAX) {
+        parser_error(&c->parser, JSON_ERROR_INVALID_ESCAPE, offset);
+        return false;
+    }
+    *out = c->scratch;
+    return true;
+}
+
+/* The token of the current value if it has type t, without reading it. */
+static struct json_lexer_token_t *cursor_peek(struct json_cursor_t *c, enum json_lexer_token_type_t t) {
+    if (c->error.code || !cursor_top(c)->pending || fill_lookahead(&c->parser)->type != t)
+        return NULL;
+    return &c->parser.lookahead;
+}
+
+/* Read the current value, whose token has just been peeked. */
+static void cursor_consume(struct json_cursor_t *c) {
+    match_token(&c->parser, c->parser.lookahead.type);
+    cursor_top(c)->pending = false;
+}
+
+/* Skip the current value if it was not read. */
+static bool cursor_skip_pending(struct json_cursor_t *c) {
+    struct json_cursor_frame_t *top = cursor_top(c);
+
+    if (!top->pending)
+        return true;
+    top->pending = false;
+    return skip_fast(&c->parser);
+}
+
+/* Move to the next member of the innermost container, but not past its closing bracket. */
+static bool cursor_member(struct json_cursor_t *c) {
+    struct json_cursor_frame_t *top = cursor_top(c);
+    struct json_parser_context_t *ctx = &c->parser;
+
+    if (!cursor_skip_pending(c) || lookahead_token(ctx, top->is_obj ? JLT_RPAIR : JLT_RARRAY))
+        return false;
+    if (!top->first && !match_token(ctx, JLT_COMMA))
+        return false;
+
+    if (top->is_obj) {
+        if (!match_token(ctx, JLT_STRING))
+            return false;
+        c->key = current_token(ctx)->text;
+        c->key_len = current_token(ctx)->end - current_token(ctx)->start;
+        if (!match_token(ctx, JLT_COLON))
+            return false;
+    }
+
+    top->first = false;
+    top->pending = true;
+    return true;
+}
+
+static bool cursor_key_is(struct json_cursor_t *c, const char *key) {
+    const char *text;
+    size_t len;
+
+    if (!cursor_decode(c, c->key, c->key_len, c->key - c->lexer.from_string - 1, &text, &len))
+        return false;
+    return len == strlen(key) && memcmp(text, key, len) == 0;
+}
+
+enum json_token_type_t json_cursor_type(struct json_cursor_t *c) {
+    enum json_token_type_t type = JT_MISSING;
+
+    if (c->error.code || !cursor_top(c)->pending)
+        return JT_MISSING;
+
+    switch (fill_lookahead(&c->parser)->type) {
+    case JLT_LPAIR: type = JT_OBJECT; break;
+    case JLT_LARRAY: type = JT_ARRAY; break;
+    case JLT_STRING: type = JT_STRING; break;
+    case JLT_NUMBER: type = JT_NUMBER; break;
+    case JLT_TRUE: case JLT_FALSE: type = JT_BOOL; break;
+    case JLT_NULL: type = JT_NULL; break;
+    default: unexpected_token(&c->parser, JSON_ERROR_UNEXPECTED_TOKEN); break;
+    }
+
+    cursor_done(c, true);
+    return type;
+}
+
+static bool cursor_enter(struct json_cursor_t *c, bool is_obj) {
+    size_t max_depth = c->parser.config.max_depth ? c->parser.config.max_depth : JSON_MAX_DEPTH;
+    struct json_lexer_token_t *token = cursor_peek(c, is_obj ? JLT_LPAIR : JLT_LARRAY);
+
+    if (!token)
+        return false;
+
+    if (c->depth == max_depth) {
+        parser_error(&c->parser, JSON_ERROR_DEPTH, token->start);
+        return cursor_done(c, false);
+    }
+
+    if (c->depth + 1 == c->capacity) {
+        struct json_cursor_frame_t *grown = (struct json_cursor_frame_t *)realloc(
+            c->frames, 2 * c->capacity * sizeof(struct json_cursor_frame_t));
+        if (!grown) {
+            parser_error(&c->parser, JSON_ERROR_NO_MEMORY, token->start);
+            return cursor_done(c, false);
+        }
+        c->frames = grown;
+        c->capacity *= 2;
+    }
+
+    cursor_consume(c);
+    c->frames[++c->depth] = (struct json_cursor_frame_t){
+        .start = c->lexer.offset,
+        .is_obj = is_obj,
+        .first = true,
+        .pending = false,
+    };
+    return true;
+}
+
+bool json_cursor_enter_object(struct json_cursor_t *c) { return cursor_enter(c, true); }
+bool json_cursor_enter_array(struct json_cursor_t *c) { return cursor_enter(c, false); }
+
+bool json_cursor_next(struct json_cursor_t *c) {
+    if (c->error.code || c->depth == 0)
+        return false;
+
+    if (cursor_member(c))
+        return cursor_done(c, true);
+
+    // step out past the closing bracket
+    if (!c->parser.error.code && match_token(&c->parser, cursor_top(c)->is_obj ? JLT_RPAIR : JLT_RARRAY))
+        c->depth--;
+    return cursor_done(c, false);
+}
+
+bool json_cursor_key(struct json_cursor_t *c, const char **key, size_t *len) {
+    struct json_cursor_frame_t *top = cursor_top(c);
+
+    if (c->error.code || c->depth == 0 || !top->is_obj || top->first)
+        return false;
+    return cursor_done(c, cursor_decode(c, c->key, c->key_len, c->key - c->lexer.from_string - 1, key, len));
+}
+
+bool json_cursor_find(struct json_cursor_t *c, const char *key) {
+    struct json_cursor_frame_t *top = cursor_top(c);
+    struct json_parser_context_t *ctx = &c->parser;
+    bool was_first = top->first;
+    size_t stop;
+
+    if (c->error.code || c->depth == 0 || !top->is_obj || !cursor_skip_pending(c))
+        return cursor_done(c, false);
+
+    // the comma or bracket after the current member, or the first key
+    stop = token_offset(fill_lookahead(ctx));
+
+    while (cursor_member(c)) {
+        if (cursor_key_is(c, key))
+            return cursor_done(c, true);
+    }
+    if (ctx->error.code || was_first)
+        return cursor_done(c, false);
+
+    // wrap around to the members before the current one
+    seek_lexer(&c->lexer, top->start, c->lexer.from_string_len);
+    ctx->has_lookahead = false;
+    top->first = true;
+    top->pending = false;
+
+    for (;;) {
+        if (!cursor_skip_pending(c) || token_offset(fill_lookahead(ctx)) == stop || !cursor_member(c))
+            break;
+        if (cursor_key_is(c, key))
+            return cursor_done(c, true);
+    }
+    return cursor_done(c, false);
+}
+
+/* The token of the current value if it is a number, NULL with an error if it is not a valid one. */
+static struct json_lexer_token_t *cursor_number(struct json_cursor_t *c) {
+    struct json_lexer_token_t *token = cursor_peek(c, JLT_NUMBER);
+
+    if (token && !is_number(token->text, token->end - token->start)) {
+        parser_error(&c->parser, JSON_ERROR_INVALID_NUMBER, token->start);
+        cursor_done(c, false);
+        return NULL;
+    }
+    return token;
+}
+
+bool json_cursor_get_i64(struct json_cursor_t *c, int64_t *out) {
+    struct json_lexer_token_t *token = cursor_number(c);
+    union json_t value;
+
+    if (!token || !decode_number(token->text, token->end - token->start, &value) || value.type != JT_INT)
+        return false;
+
+    *out = value.tok.i64;
+    cursor_consume(c);
+    return true;
+}
+
+bool json_cursor_get_u64(struct json_cursor_t *c, uint64_t *out) {
+    struct json_lexer_token_t *token = cursor_number(c);
+    union json_t value;
+
+    if (!token || !decode_number(token->text, token->end - token->start, &value) ||
+        (value.type != JT_UINT && (value.type != JT_INT || value.tok.i64 < 0)))
+        return false;
+
+    *out = value.type == JT_UINT ? value.tok.u64 : (uint64_t)value.tok.i64;
+    cursor_consume(c);
+    return true;
+}
+
+bool json_cursor_get_f64(struct json_cursor_t *c, double *out) {
+    struct json_lexer_token_t *token = cursor_number(c);
+
+    if (!token)
+        return false;
+
+    json_parse_double(token->text, token->end - token->start, out);
+    cursor_consume(c);
+    return true;
+}
+
+bool json_cursor_get_bool(struct json_cursor_t *c, bool *out) {
+    if (cursor_peek(c, JLT_TRUE)) {
+        *out = true;
+    } else if (cursor_peek(c, JLT_FALSE)) {
+        *out = false;
+    } else {
+        return false;
+    }
+
+    cursor_consume(c);
+    return true;
+}
+
+bool json_cursor_get_null(struct json_cursor_t *c) {
+    if (!cursor_peek(c, JLT_NULL))
+        return false;
+
+    cursor_consume(c);
+    return true;
+}
+
+bool json_cursor_get_str(struct json_cursor_t *c, const char **str, size_t *len) {
+    struct json_lexer_token_t *token = cursor_peek(c, JLT_STRING);
+
+    if (!token)
+        return false;
+    if (!cursor_decode(c, token->text, token->end - token->start, token_offset(token), str, len))
+        return cursor_done(c, false);
+
+    cursor_consume(c);
+    return true;
+}
+
+bool json_cursor_get_value(struct json_cursor_t *c, union json_t *out) {
+    struct json_doc_t *doc = c->parser.config.doc;
+    union json_t value;
+
+    if (c->error.code || !cursor_top(c)->pending)
+        return false;
+
+    if (doc)
+        json_doc_begin(doc);
+    value = parse_iterative(&c->parser);
+    if (doc)
+        json_doc_end(doc);
+
+    cursor_top(c)->pending = false;
+    if (!cursor_done(c, true))
+        return false;
+
+    *out = value;
+    return true;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Cursor
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: JSON Document
+// --------------------------------------------------
+
+struct json_doc_t *json_doc_new(void) {
+    struct json_doc_t *doc = (struct json_doc_t *)calloc(1, sizeof(struct json_doc_t));
+    if (!doc) {
+        JSON_LOG_ERROR("Memory allocation failed");
+        return NULL;
+    }
+    return doc;
+}
+
+void json_doc_free(struct json_doc_t *doc) {
+    if (!doc)
+        return;
+
+    assert(active_doc != doc);
+
+    struct json_arena_chunk_t *chunk = doc->arena.chunks;
+    while (chunk) {
+        struct json_arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    if (doc->map)
+        munmap(doc->map, doc->map_len);
+    free(doc);
+}
+
+void json_doc_begin(struct json_doc_t *doc) {
+    doc->outer = active_doc;
+    active_doc = doc;
+}
+
+void json_doc_end(struct json_doc_t *doc) {
+    assert(active_doc == doc);
+    active_doc = doc->outer;
+    doc->outer = NULL;
+}
+
+struct json_doc_t *__json_doc_suspend(void) {
+    struct json_doc_t *doc = active_doc;
+    active_doc = NULL;
+    return doc;
+}
+
+void __json_doc_resume(struct json_doc_t *doc) {
+    assert(!active_doc);
+    active_doc = doc;
+}
+
+struct json_doc_t *json_doc_deserialize(const char *input_text) {
+    struct json_doc_t *doc = json_doc_new();
+    if (!doc)
+        return NULL;
+
+    doc->root = json_deserialize_with(input_text, .doc = doc);
+    return doc;
+}
+
+struct json_doc_t *json_doc_file(const char *file_path) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        JSON_LOG_WARNING("Could not open file: %s", file_path);
+        return NULL;
+    }
+
+    struct json_doc_t *doc = json_doc_new();
+    if (!doc) {
+        close(fd);
+        return NULL;
+    }
+
+    doc->map = map_file(fd, &doc->map_len, true);
+    if (doc->map) {
+        doc->root = __json_deserialize_n_with(doc->map, doc->map_len,
+                                              (struct json_parse_config){.doc = doc, .in_situ = true});
+    } else {
+        json_doc_begin(doc);
+        doc->root = load_fd(fd);
+        json_doc_end(doc);
+    }
+
+    close(fd);
+    return doc;
+}
+
+struct json_doc_t *json_doc_deserialize_in_situ(char *buffer) {
+    struct json_doc_t *doc = json_doc_new();
+    if (!doc)
+        return NULL;
+
+    doc->root = json_deserialize_with(buffer, .doc = doc, .in_situ = true);
+    return doc;
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Document
 // --------------------------------------------------
@@ -0,0 +1,39 @@
+#ifndef __JSON_FLOAT_H__
+#define __JSON_FLOAT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "json.h"
+
+/* Load 8 bytes as a little-endian word. */
+static inline uint64_t load_u64_le(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/* True if all 8 bytes at p are ASCII digits. */
+static inline bool is_eight_digits(const char *p) {
+    uint64_t v = load_u64_le(p);
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+            0x3333333333333333ULL);
+}
+
+/*
+ * SWAR: convert 8 ASCII digits to their value in three multiplications,
+ * combining pairs of digits, then pairs of pairs, then the two halves.
+ */
+static inline uint32_t parse_eight_digits(const char *p) {
+    uint64_t v = load_u64_le(p) & 0x0F0F0F0F0F0F0F0FULL;
+    v = (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FFULL;
+    v = (v * 100 + (v >> 16)) & 0x0000FFFF0000FFFFULL;
+    return (uint32_t)(v * 10000 + (v >> 32));
+}
+
+#endif /* __JSON_FLOAT_H__ */
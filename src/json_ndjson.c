@@ -0,0 +1,354 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "json.h"
+
+// --------------------------------------------------
+// SECTION: JSON Lines
+// --------------------------------------------------
+
+/* A run of whole lines, parsed by one worker. */
+struct ndjson_batch_t {
+    const char *start;
+    const char *end;
+    struct json_record_t *records;
+    size_t count;
+    size_t lines; /* blank lines included */
+    struct json_error_t error; /* set if the records could not grow, at the first line left out */
+    bool done;
+};
+
+/*
+ * Workers cut the input into batches and parse them in any order, the
+ * calling thread delivers them in input order. At most ring_size batches
+ * are cut but not yet delivered, which bounds the memory held by results.
+ */
+struct ndjson_pool_t {
+    struct json_ndjson_config config;
+    const char *buf;
+    const char *cursor; /* start of the next batch */
+    const char *end;
+    struct ndjson_batch_t *ring;
+    size_t ring_size;
+    size_t cut;
+    size_t delivered;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+/* Records delivered so far */
+struct ndjson_out_t {
+    struct json_record_t *records;
+    size_t count;
+    size_t capacity;
+    size_t lines;
+};
+
+static bool is_blank(const char *p, const char *end) {
+    for (; p < end; p++) {
+        if (*p != ' ' && *p != '\t' && *p != '\r')
+            return false;
+    }
+    return true;
+}
+
+/* Take the next batch_size bytes, extended to the end of the line. */
+static bool cut_batch(struct ndjson_pool_t *pool, struct ndjson_batch_t *b) {
+    size_t batch_size = pool->config.batch_size ? pool->config.batch_size : JSON_NDJSON_BATCH;
+    const char *start = pool->cursor;
+    const char *end;
+
+    if (start >= pool->end)
+        return false;
+
+    if ((size_t)(pool->end - start) <= batch_size) {
+        end = pool->end;
+    } else {
+        const char *nl = (const char *)memchr(start + batch_size - 1, '\n', pool->end - (start + batch_size - 1));
+        end = nl ? nl + 1 : pool->end;
+    }
+
+    *b = (struct ndjson_batch_t){.start = start, .end = end};
+    pool->cursor = end;
+    return true;
+}
+
+/* Parse every non-blank line of a batch. Error rows count from the start of the batch. */
+static void parse_batch(struct ndjson_pool_t *pool, struct ndjson_batch_t *b) {
+    size_t capacity = 0;
+    const char *p = b->start;
+
+    while (p < b->end) {
+        const char *nl = (const char *)memchr(p, '\n', b->end - p);
+        const char *eol = nl ? nl : b->end;
+
+        b->lines++;
+        if (eol > p && eol[-1] == '\r')
+            eol--;
+
+        if (!is_blank(p, eol)) {
+            if (b->count == capacity) {
+                capacity = capacity ? 2 * capacity : 64;
+                struct json_record_t *grown =
+                    (struct json_record_t *)realloc(b->records, capacity * sizeof(struct json_record_t));
+                if (!grown) {
+                    JSON_LOG_ERROR("Memory allocation failed");
+                    b->error = (struct json_error_t){.code = JSON_ERROR_NO_MEMORY, .offset = (size_t)(p - pool->buf),
+                                                     .row = b->lines};
+                    return;
+                }
+                b->records = grown;
+            }
+
+            struct json_record_t *r = &b->records[b->count++];
+            struct json_parse_config config = {
+                .typed_numbers = pool->config.typed_numbers,
+                .max_depth = pool->config.max_depth,
+                .error = &r->error,
+                .validate_utf8 = pool->config.validate_utf8,
+            };
+
+            r->value = __json_deserialize_n_with(p, eol - p, config);
+            if (r->error.code) {
+                r->error.offset += p - pool->buf;
+                r->error.row = b->lines;
+            }
+        }
+
+        p = nl ? nl + 1 : b->end;
+    }
+}
+
+static void deliver_record(struct ndjson_pool_t *pool, struct json_record_t *r, struct ndjson_out_t *out) {
+    if (r->error.code)
+        r->error.row += out->lines;
+
+    if (pool->config.callback) {
+        pool->config.callback(out->count++, r, pool->config.args);
+        return;
+    }
+
+    if (out->count == out->capacity) {
+        size_t capacity = out->capacity ? 2 * out->capacity : 64;
+        struct json_record_t *grown =
+            (struct json_record_t *)realloc(out->records, capacity * sizeof(struct json_record_t));
+        if (!grown) {
+            JSON_LOG_ERROR("Memory allocation failed");
+            json_clean(&r->value);
+            return;
+        }
+        out->records = grown;
+        out->capacity = capacity;
+    }
+    out->records[out->count++] = *r;
+}
+
+/*
+ * Hand a parsed batch to the callback or the output array, in input order.
+ * A batch cut short ends in a record holding its error and no value.
+ */
+static void deliver_batch(struct ndjson_pool_t *pool, struct ndjson_batch_t *b, struct ndjson_out_t *out) {
+    for (size_t i = 0; i < b->count; i++)
+        deliver_record(pool, &b->records[i], out);
+
+    if (b->error.code) {
+        struct json_record_t r = {.value = JSON_MISSING, .error = b->error};
+        deliver_record(pool, &r, out);
+    }
+
+    out->lines += b->lines;
+    free(b->records);
+}
+
+static void *ndjson_worker(void *arg) {
+    struct ndjson_pool_t *pool = (struct ndjson_pool_t *)arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->cursor < pool->end && pool->cut - pool->delivered == pool->ring_size)
+            pthread_cond_wait(&pool->cond, &pool->lock);
+
+        struct ndjson_batch_t *b = &pool->ring[pool->cut % pool->ring_size];
+        if (!cut_batch(pool, b))
+            break;
+        pool->cut++;
+
+        pthread_mutex_unlock(&pool->lock);
+        parse_batch(pool, b);
+        pthread_mutex_lock(&pool->lock);
+
+        b->done = true;
+        pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static void deliver_in_order(struct ndjson_pool_t *pool, struct ndjson_out_t *out) {
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        struct ndjson_batch_t *b = &pool->ring[pool->delivered % pool->ring_size];
+
+        while (!(pool->delivered < pool->cut && b->done) && !(pool->cursor >= pool->end && pool->delivered == pool->cut))
+            pthread_cond_wait(&pool->cond, &pool->lock);
+
+        if (pool->delivered == pool->cut)
+            break;
+
+        // the slot is not reused before delivered moves past it
+        pthread_mutex_unlock(&pool->lock);
+        deliver_batch(pool, b, out);
+        pthread_mutex_lock(&pool->lock);
+
+        pool->delivered++;
+        pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+size_t __json_ndjson_parse(const char *buf, size_t len, struct json_record_t **records,
+                           struct json_ndjson_config config) {
+    struct ndjson_pool_t pool = {
+        .config = config,
+        .buf = buf,
+        .cursor = buf,
+        .end = buf + len,
+    };
+    struct ndjson_out_t out = {0};
+    size_t threads = config.threads;
+    size_t started = 0;
+    pthread_t *workers = NULL;
+
+    if (!threads) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+
+    if (threads > 1) {
+        pool.ring_size = 4 * threads;
+        pool.ring = (struct ndjson_batch_t *)calloc(pool.ring_size, sizeof(struct ndjson_batch_t));
+        workers = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    }
+
+    if (pool.ring && workers) {
+        pthread_mutex_init(&pool.lock, NULL);
+        pthread_cond_init(&pool.cond, NULL);
+
+        for (; started < threads; started++) {
+            if (pthread_create(&workers[started], NULL, ndjson_worker, &pool) != 0)
+                break;
+        }
+
+        if (started)
+            deliver_in_order(&pool, &out);
+
+        for (size_t i = 0; i < started; i++)
+            pthread_join(workers[i], NULL);
+
+        pthread_cond_destroy(&pool.cond);
+        pthread_mutex_destroy(&pool.lock);
+    }
+
+    // one thread, or no worker could be started
+    if (!started) {
+        // the values are malloc'd, like those parsed on a worker
+        struct json_doc_t *doc = __json_doc_suspend();
+        struct ndjson_batch_t b;
+        while (cut_batch(&pool, &b)) {
+            parse_batch(&pool, &b);
+            deliver_batch(&pool, &b, &out);
+        }
+        __json_doc_resume(doc);
+    }
+
+    free(workers);
+    free(pool.ring);
+
+    if (records)
+        *records = out.records;
+    else
+        json_ndjson_free(out.records, config.callback ? 0 : out.count);
+
+    return out.count;
+}
+
+size_t __json_ndjson_file(const char *file_path, struct json_record_t **records, struct json_ndjson_config config) {
+    struct stat st;
+    char *buf = NULL;
+    size_t len = 0, count;
+    bool mapped = false;
+
+    if (records)
+        *records = NULL;
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        JSON_LOG_WARNING("Could not open file: %s", file_path);
+        return 0;
+    }
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            buf = (char *)map;
+            len = st.st_size;
+            mapped = true;
+            // workers move through the file from front to back
+            posix_madvise(map, len, POSIX_MADV_SEQUENTIAL);
+        }
+    }
+
+    // pipes and other files that cannot be mapped are read whole
+    if (!mapped) {
+        size_t capacity = 0;
+        ssize_t n = 0;
+
+        do {
+            len += n;
+            if (len == capacity) {
+                capacity = capacity ? 2 * capacity : JSON_STREAM_CHUNK;
+                char *grown = (char *)realloc(buf, capacity);
+                if (!grown) {
+                    JSON_LOG_ERROR("Memory allocation failed");
+                    free(buf);
+                    close(fd);
+                    return 0;
+                }
+                buf = grown;
+            }
+        } while ((n = read(fd, buf + len, capacity - len)) > 0);
+    }
+
+    count = __json_ndjson_parse(buf, len, records, config);
+
+    if (mapped)
+        munmap(buf, len);
+    else
+        free(buf);
+    close(fd);
+    return count;
+}
+
+void json_ndjson_free(struct json_record_t *records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].value.type != JT_MISSING)
+            json_clean(&records[i].value);
+    }
+    free(records);
+}
+
+// --------------------------------------------------
+// !SECTION: END JSON Lines
+// --------------------------------------------------
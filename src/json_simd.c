@@ -0,0 +1,312 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+#include "json_float.h"
+#include "json_simd.h"
+
+// --------------------------------------------------
+// SECTION: Block Classification Kernels
+// --------------------------------------------------
+
+/*
+ * Each kernel fills the four class bitmaps of one 64-byte block. The vector
+ * kernels live in json_simd_<isa>.c, each built with its own instruction set
+ * flags, and the best one this CPU runs is picked when the library is loaded.
+ * Set JSON_SIMD_ENV to a kernel name to force it.
+ */
+
+/* High bit set in every byte of v equal to c. No carry crosses bytes, so every byte is exact. */
+static inline uint64_t swar_eq(uint64_t v, uint8_t c) {
+    uint64_t x = v ^ (0x0101010101010101ULL * c);
+    return ~(((x & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | x) & 0x8080808080808080ULL;
+}
+
+/* Move the high bit of byte k to bit k */
+static inline uint64_t swar_movemask(uint64_t m) { return ((m >> 7) * 0x0102040810204080ULL) >> 56; }
+
+/* Eight bytes per step in a general purpose register, so builds without vector units are not left byte by byte. */
+static void classify_scalar(const uint8_t *in, struct json_block_t *b) {
+    uint64_t backslash = 0, quote = 0, whitespace = 0, op = 0;
+
+    for (int i = 0; i < JSON_BLOCK_SIZE; i += 8) {
+        uint64_t v = load_u64_le((const char *)in + i);
+        /* [ and ] become { and } */
+        uint64_t curly = v | 0x2020202020202020ULL;
+
+        backslash |= swar_movemask(swar_eq(v, '\\')) << i;
+        quote |= swar_movemask(swar_eq(v, '"')) << i;
+        whitespace |= swar_movemask(swar_eq(v, ' ') | swar_eq(v, '\t') | swar_eq(v, '\n') | swar_eq(v, '\r')) << i;
+        op |= swar_movemask(swar_eq(curly, '{') | swar_eq(curly, '}') | swar_eq(v, ',') | swar_eq(v, ':')) << i;
+    }
+
+    b->backslash = backslash;
+    b->quote = quote;
+    b->whitespace = whitespace;
+    b->op = op;
+}
+
+static size_t scan_string_scalar(const uint8_t *p, size_t len) {
+    size_t i = 0;
+
+    while (i < len && p[i] != '"' && p[i] != '\\' && p[i] >= 0x20)
+        i++;
+    return i;
+}
+
+/* ASCII is skipped 8 bytes at a time. */
+size_t json_utf8_error_offset(const uint8_t *p, size_t len) {
+    size_t i = 0;
+
+    while (i < len) {
+        if (len - i >= 8 && !(load_u64_le((const char *)p + i) & 0x8080808080808080ULL)) {
+            i += 8;
+            continue;
+        }
+
+        uint8_t c = p[i];
+        uint8_t lo = 0x80, hi = 0xBF;
+        size_t n;
+
+        if (c < 0x80) {
+            i++;
+            continue;
+        } else if (c >= 0xC2 && c <= 0xDF) {
+            n = 1;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            n = 2;
+            if (c == 0xE0)
+                lo = 0xA0; // overlong
+            else if (c == 0xED)
+                hi = 0x9F; // surrogates
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            n = 3;
+            if (c == 0xF0)
+                lo = 0x90; // overlong
+            else if (c == 0xF4)
+                hi = 0x8F; // above U+10FFFF
+        } else {
+            return i;
+        }
+
+        if (len - i <= n || p[i + 1] < lo || p[i + 1] > hi)
+            return i;
+        for (size_t k = 2; k <= n; k++) {
+            if ((p[i + k] & 0xC0) != 0x80)
+                return i;
+        }
+        i += n + 1;
+    }
+
+    return len;
+}
+
+static bool validate_utf8_scalar(const uint8_t *p, size_t len) { return json_utf8_error_offset(p, len) == len; }
+
+/*
+ * Error classes of a byte pair for the vector UTF-8 kernels. A bit set in the
+ * lookups of all three nibbles is an error. A continuation after a
+ * continuation (TWO_CONTS) is an error on its own, the kernels cancel it
+ * where a 3 or 4 byte lead sits two or three bytes back.
+ */
+#define TOO_SHORT (1 << 0)      /* lead or ASCII, then a lead */
+#define TOO_LONG (1 << 1)       /* ASCII, then a continuation */
+#define OVERLONG_3 (1 << 2)     /* E0 80..9F */
+#define TOO_LARGE (1 << 3)      /* F4 90..BF, or a lead above F4 */
+#define SURROGATE (1 << 4)      /* ED A0..BF */
+#define OVERLONG_2 (1 << 5)     /* C0 or C1 */
+#define TOO_LARGE_1000 (1 << 6) /* lead above F4, then 80..8F */
+#define OVERLONG_4 (1 << 6)     /* F0 80..8F */
+#define TWO_CONTS (1 << 7)      /* continuation, then a continuation */
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+const uint8_t json_utf8_byte_1_high[16] = {
+    // 0___ ASCII
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    // 10__ continuation
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    // 1100, 1101 two byte lead
+    TOO_SHORT | OVERLONG_2, TOO_SHORT,
+    // 1110 three byte lead
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    // 1111 four byte lead
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+const uint8_t json_utf8_byte_1_low[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+const uint8_t json_utf8_byte_2_high[16] = {
+    // 0___ ASCII
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    // 1000, 1001, 101_ continuation
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    // 11__ lead
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+const struct json_kernels_t json_kernels_scalar = {
+    .name = "scalar",
+    .classify_block = classify_scalar,
+    .scan_string = scan_string_scalar,
+    .validate_utf8 = validate_utf8_scalar,
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_X86 1
+#endif
+
+/* Best first, the scalar kernel is always there */
+static const struct json_kernels_t *const kernels[] = {
+#ifdef JSON_X86
+    &json_kernels_avx512,
+    &json_kernels_avx2,
+    &json_kernels_sse42,
+#endif
+    &json_kernels_scalar,
+};
+
+static const struct json_kernels_t *active = &json_kernels_scalar;
+
+/* True if the kernel was compiled in and this CPU can run it. */
+static bool kernel_runs(const struct json_kernels_t *k) {
+    if (!k->classify_block)
+        return false;
+#ifdef JSON_X86
+    if (k == &json_kernels_avx512)
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    if (k == &json_kernels_avx2)
+        return __builtin_cpu_supports("avx2");
+    if (k == &json_kernels_sse42)
+        return __builtin_cpu_supports("sse4.2");
+#endif
+    return true;
+}
+
+bool json_simd_use(const char *name) {
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        if (strcmp(kernels[i]->name, name) == 0 && kernel_runs(kernels[i])) {
+            active = kernels[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Runs once when the library is loaded, before any parse. */
+__attribute__((constructor)) static void select_kernel(void) {
+    const char *forced = getenv(JSON_SIMD_ENV);
+
+    if (forced && *forced) {
+        if (json_simd_use(forced))
+            return;
+        JSON_LOG_WARNING("%s=%s is not available on this CPU or build", JSON_SIMD_ENV, forced);
+    }
+
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        if (kernel_runs(kernels[i])) {
+            active = kernels[i];
+            return;
+        }
+    }
+}
+
+const char *json_simd_kernel_name(void) { return active->name; }
+
+void json_classify_block(const uint8_t *block, struct json_block_t *b) { active->classify_block(block, b); }
+
+size_t json_scan_string(const uint8_t *p, size_t len) { return active->scan_string(p, len); }
+
+bool json_validate_utf8(const uint8_t *p, size_t len) { return active->validate_utf8(p, len); }
+
+// --------------------------------------------------
+// !SECTION: END Block Classification Kernels
+// --------------------------------------------------
+
+// --------------------------------------------------
+// SECTION: Structural Index
+// --------------------------------------------------
+
+/*
+ * Return the bytes escaped by a backslash. A backslash run escapes the byte
+ * after it only when the run has odd length, e.g. in `\\\"` the quote is
+ * escaped but in `\\"` it is not. The carry holds whether the first byte of
+ * the next block is escaped.
+ */
+static uint64_t find_escaped(uint64_t backslash, uint64_t *next_is_escaped) {
+    const uint64_t odd_bits = 0xAAAAAAAAAAAAAAAAULL;
+
+    if (!backslash) {
+        uint64_t escaped = *next_is_escaped;
+        *next_is_escaped = 0;
+        return escaped;
+    }
+
+    /* a backslash that is itself escaped cannot start a run */
+    uint64_t potential_escape = backslash & ~*next_is_escaped;
+    uint64_t maybe_escaped = potential_escape << 1;
+    /* subtracting the run starts flips the parity bit at the end of every even-aligned run */
+    uint64_t escape_and_terminal_code = ((maybe_escaped | odd_bits) - potential_escape) ^ odd_bits;
+    uint64_t escaped = escape_and_terminal_code ^ (backslash | *next_is_escaped);
+    uint64_t escape = escape_and_terminal_code & backslash;
+
+    *next_is_escaped = escape >> 63;
+    return escaped;
+}
+
+/* Bit i is the xor of bits 0..i, so every byte from an opening quote up to the closing one is set. */
+static uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+uint64_t json_stage1_block(struct json_stage1_t *s, const uint8_t *block) {
+    struct json_block_t b;
+
+    json_classify_block(block, &b);
+
+    uint64_t escaped = find_escaped(b.backslash, &s->prev_escaped);
+    uint64_t quote = b.quote & ~escaped;
+
+    /* opening quote and string content are set, the closing quote is not */
+    uint64_t in_string = prefix_xor(quote) ^ s->prev_in_string;
+    s->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+    /* a scalar starts at a non-space, non-operator byte that does not follow another one */
+    uint64_t scalar = ~(b.op | b.whitespace | b.quote);
+    uint64_t follows_scalar = (scalar << 1) | s->prev_scalar;
+    s->prev_scalar = scalar >> 63;
+
+    return ((b.op | (scalar & ~follows_scalar)) & ~in_string) | (quote & in_string);
+}
+
+// --------------------------------------------------
+// !SECTION: END Structural Index
+// --------------------------------------------------
@@ -0,0 +1,76 @@
+#ifndef __JSON_SIMD_H__
+#define __JSON_SIMD_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "json.h"
+
+#define JSON_BLOCK_SIZE 64
+
+/*
+ * Character classes of a 64-byte block, one bit per byte.
+ * Bit i belongs to block[i].
+ */
+struct json_block_t {
+    uint64_t backslash;
+    uint64_t quote;
+    uint64_t whitespace;
+    uint64_t op; /* { } [ ] , : */
+};
+
+/* Environment variable that forces a kernel by name, for benchmarks and tests */
+#define JSON_SIMD_ENV "JSON_SIMD_KERNEL"
+
+/* One implementation of every vectorized operation. A NULL entry was not compiled in. */
+struct json_kernels_t {
+    const char *name;
+    void (*classify_block)(const uint8_t *block, struct json_block_t *b);
+    /* Offset of the first '"', '\\' or control byte in p[0..len), len if there is none */
+    size_t (*scan_string)(const uint8_t *p, size_t len);
+    /* True if p[0..len) is well-formed UTF-8 */
+    bool (*validate_utf8)(const uint8_t *p, size_t len);
+};
+
+extern const struct json_kernels_t json_kernels_scalar;
+extern const struct json_kernels_t json_kernels_sse42;
+extern const struct json_kernels_t json_kernels_avx2;
+extern const struct json_kernels_t json_kernels_avx512;
+
+/* Name of the kernel in use */
+const char *json_simd_kernel_name(void);
+/*
+ * Switch to the kernel `name` ("scalar", "sse4.2", "avx2" or "avx512").
+ * Return false if it was not compiled in or this CPU cannot run it. Not
+ * safe while other threads parse.
+ */
+bool json_simd_use(const char *name);
+
+void json_classify_block(const uint8_t *block, struct json_block_t *b);
+
+/* Skip string content: return the offset of the first '"', '\\' or byte below 0x20, or len. */
+size_t json_scan_string(const uint8_t *p, size_t len);
+
+/* True if p[0..len) is well-formed UTF-8: no overlong forms, surrogates or code points above U+10FFFF. */
+bool json_validate_utf8(const uint8_t *p, size_t len);
+/* Offset of the first byte that does not start a well-formed sequence, or len. Scalar, to locate an error. */
+size_t json_utf8_error_offset(const uint8_t *p, size_t len);
+
+/*
+ * Lookup tables of the vector UTF-8 kernels (Keiser and Lemire, "Validating
+ * UTF-8 In Less Than One Instruction Per Byte"), indexed by the high and low
+ * nibble of the first byte of a pair and the high nibble of the second.
+ */
+extern const uint8_t json_utf8_byte_1_high[16];
+extern const uint8_t json_utf8_byte_1_low[16];
+extern const uint8_t json_utf8_byte_2_high[16];
+
+/*
+ * Classify the next 64-byte block and return the bitmap of its structural
+ * positions: operators and string openings outside strings, plus the first
+ * byte of every scalar (number, true, false, null).
+ */
+uint64_t json_stage1_block(struct json_stage1_t *s, const uint8_t *block);
+
+#endif /* __JSON_SIMD_H__ */
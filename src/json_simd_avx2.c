@@ -0,0 +1,138 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "json.h"
+#include "json_simd.h"
+
+/*
+ * Built with -mavx2 on x86, see the simd option. Without the flags the table
+ * is left empty and the kernel is never picked, see json_simd.c.
+ */
+#if defined(__AVX2__)
+static void classify_avx2(const uint8_t *in, struct json_block_t *b) {
+    const __m256i ws_table = _mm256_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100,
+                                              ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100);
+    const __m256i lower = _mm256_set1_epi8(0x20);
+
+    b->backslash = b->quote = b->whitespace = b->op = 0;
+
+    for (int i = 0; i < JSON_BLOCK_SIZE; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i curly = _mm256_or_si256(v, lower);
+
+        __m256i ws = _mm256_cmpeq_epi8(_mm256_shuffle_epi8(ws_table, v), v);
+        __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(curly, _mm256_set1_epi8('{')),
+                                                     _mm256_cmpeq_epi8(curly, _mm256_set1_epi8('}'))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')),
+                                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':'))));
+
+        b->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << i;
+        b->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << i;
+        b->whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << i;
+        b->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << i;
+    }
+}
+
+/* 32 bytes at a time, the tail that does not fill a register goes byte by byte. */
+static size_t scan_string_avx2(const uint8_t *p, size_t len) {
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        /* bytes up to 0x1F are left unchanged by the unsigned max */
+        __m256i stop = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(stop);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+
+    while (i < len && p[i] != '"' && p[i] != '\\' && p[i] >= 0x20)
+        i++;
+    return i;
+}
+
+/* Error bits of every byte pair ending in input, prev holds the 32 bytes before it. */
+static __m256i utf8_errors_avx2(__m256i input, __m256i prev) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    /* the alignr below works per 128-bit lane, so pair each lane with the one before it */
+    __m256i before = _mm256_permute2x128_si256(prev, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, before, 15);
+    __m256i prev2 = _mm256_alignr_epi8(input, before, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, before, 13);
+
+    const __m256i byte_1_high_table =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)json_utf8_byte_1_high));
+    const __m256i byte_1_low_table =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)json_utf8_byte_1_low));
+    const __m256i byte_2_high_table =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)json_utf8_byte_2_high));
+
+    __m256i byte_1_high = _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    /* bit 7 set where a 3 or 4 byte lead two or three bytes back wants a continuation */
+    __m256i must_continue = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+                                            _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80)));
+    return _mm256_xor_si256(_mm256_and_si256(must_continue, _mm256_set1_epi8((char)0x80)), special);
+}
+
+/* The last 32 bytes are zero padded, so a sequence cut by the end fails like one cut by ASCII. */
+static bool validate_utf8_avx2(const uint8_t *p, size_t len) {
+    /* nonzero where a lead in the last three bytes still needs continuations */
+    const __m256i max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1), (char)(0xE0 - 1),
+                                         (char)(0xC0 - 1));
+    __m256i prev = _mm256_setzero_si256(), incomplete = _mm256_setzero_si256(), error = _mm256_setzero_si256();
+    uint8_t tail[32] = {0};
+    size_t i = 0;
+
+    for (;;) {
+        __m256i v;
+        bool last = len - i < 32;
+
+        if (last) {
+            memcpy(tail, p + i, len - i);
+            v = _mm256_loadu_si256((const __m256i *)tail);
+        } else {
+            v = _mm256_loadu_si256((const __m256i *)(p + i));
+        }
+
+        if (!_mm256_movemask_epi8(v)) {
+            error = _mm256_or_si256(error, incomplete);
+        } else {
+            error = _mm256_or_si256(error, utf8_errors_avx2(v, prev));
+            incomplete = _mm256_subs_epu8(v, max);
+        }
+
+        if (last)
+            break;
+        prev = v;
+        i += 32;
+    }
+
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+const struct json_kernels_t json_kernels_avx2 = {
+    .name = "avx2",
+#if defined(__AVX2__)
+    .classify_block = classify_avx2,
+    .scan_string = scan_string_avx2,
+    .validate_utf8 = validate_utf8_avx2,
+#else
+    .classify_block = NULL,
+    .scan_string = NULL,
+    .validate_utf8 = NULL,
+#endif
+};
@@ -0,0 +1,110 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+#include "json.h"
+#include "json_simd.h"
+
+/*
+ * Built with -mavx512f -mavx512bw on x86, see the simd option. Without the
+ * flags the table is left empty and the kernel is never picked, see json_simd.c.
+ */
+#if defined(__AVX512BW__)
+/* A whole block is one register, and byte compares yield the bitmaps directly. */
+static void classify_avx512(const uint8_t *in, struct json_block_t *b) {
+    const __m512i ws_table = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100));
+    __m512i v = _mm512_loadu_si512((const void *)in);
+    __m512i curly = _mm512_or_si512(v, _mm512_set1_epi8(0x20));
+
+    b->backslash = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\\'));
+    b->quote = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"'));
+    b->whitespace = _mm512_cmpeq_epi8_mask(_mm512_shuffle_epi8(ws_table, v), v);
+    b->op = _mm512_cmpeq_epi8_mask(curly, _mm512_set1_epi8('{')) | _mm512_cmpeq_epi8_mask(curly, _mm512_set1_epi8('}')) |
+            _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(',')) | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(':'));
+}
+
+/* 64 bytes at a time, the tail is loaded with a mask so nothing past len is read. */
+static size_t scan_string_avx512(const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 live = len - i >= 64 ? ~0ULL : (1ULL << (len - i)) - 1;
+        __m512i v = _mm512_maskz_loadu_epi8(live, p + i);
+        __mmask64 stop = (_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"')) |
+                          _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\\')) |
+                          _mm512_cmple_epu8_mask(v, _mm512_set1_epi8(0x1F))) &
+                         live;
+        if (stop)
+            return i + __builtin_ctzll(stop);
+    }
+    return len;
+}
+
+/* Error bits of every byte pair ending in input, prev holds the 64 bytes before it. */
+static __m512i utf8_errors_avx512(__m512i input, __m512i prev) {
+    const __m512i nibble = _mm512_set1_epi8(0x0F);
+    /* the alignr below works per 128-bit lane, so pair each lane with the one before it */
+    __m512i before = _mm512_permutex2var_epi64(prev, _mm512_setr_epi64(6, 7, 8, 9, 10, 11, 12, 13), input);
+    __m512i prev1 = _mm512_alignr_epi8(input, before, 15);
+    __m512i prev2 = _mm512_alignr_epi8(input, before, 14);
+    __m512i prev3 = _mm512_alignr_epi8(input, before, 13);
+
+    const __m512i byte_1_high_table = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)json_utf8_byte_1_high));
+    const __m512i byte_1_low_table = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)json_utf8_byte_1_low));
+    const __m512i byte_2_high_table = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)json_utf8_byte_2_high));
+
+    __m512i byte_1_high = _mm512_shuffle_epi8(byte_1_high_table, _mm512_and_si512(_mm512_srli_epi16(prev1, 4), nibble));
+    __m512i byte_1_low = _mm512_shuffle_epi8(byte_1_low_table, _mm512_and_si512(prev1, nibble));
+    __m512i byte_2_high = _mm512_shuffle_epi8(byte_2_high_table, _mm512_and_si512(_mm512_srli_epi16(input, 4), nibble));
+    __m512i special = _mm512_ternarylogic_epi32(byte_1_high, byte_1_low, byte_2_high, 0x80);
+
+    /* bit 7 set where a 3 or 4 byte lead two or three bytes back wants a continuation */
+    __m512i must_continue = _mm512_or_si512(_mm512_subs_epu8(prev2, _mm512_set1_epi8(0xE0 - 0x80)),
+                                            _mm512_subs_epu8(prev3, _mm512_set1_epi8(0xF0 - 0x80)));
+    return _mm512_xor_si512(_mm512_and_si512(must_continue, _mm512_set1_epi8((char)0x80)), special);
+}
+
+/* The masked load zero pads the last block, so a sequence cut by the end fails like one cut by ASCII. */
+static bool validate_utf8_avx512(const uint8_t *p, size_t len) {
+    /* nonzero where a lead in the last three bytes still needs continuations */
+    const __m512i max = _mm512_inserti32x4(_mm512_set1_epi8(-1),
+                                           _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                         (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)),
+                                           3);
+    __m512i prev = _mm512_setzero_si512(), incomplete = _mm512_setzero_si512(), error = _mm512_setzero_si512();
+
+    for (size_t i = 0;; i += 64) {
+        __mmask64 live = len - i >= 64 ? ~0ULL : (1ULL << (len - i)) - 1;
+        __m512i v = _mm512_maskz_loadu_epi8(live, p + i);
+
+        if (!_mm512_movepi8_mask(v)) {
+            error = _mm512_or_si512(error, incomplete);
+        } else {
+            error = _mm512_or_si512(error, utf8_errors_avx512(v, prev));
+            incomplete = _mm512_subs_epu8(v, max);
+        }
+
+        if (len - i < 64)
+            break;
+        prev = v;
+    }
+
+    return !_mm512_test_epi8_mask(error, error);
+}
+#endif
+
+const struct json_kernels_t json_kernels_avx512 = {
+    .name = "avx512",
+#if defined(__AVX512BW__)
+    .classify_block = classify_avx512,
+    .scan_string = scan_string_avx512,
+    .validate_utf8 = validate_utf8_avx512,
+#else
+    .classify_block = NULL,
+    .scan_string = NULL,
+    .validate_utf8 = NULL,
+#endif
+};
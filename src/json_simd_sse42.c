@@ -0,0 +1,133 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+#include "json.h"
+#include "json_simd.h"
+
+/*
+ * Built with -msse4.2 on x86, see the simd option. Without the flags the table
+ * is left empty and the kernel is never picked, see json_simd.c.
+ */
+#if defined(__SSE4_2__)
+static void classify_sse42(const uint8_t *in, struct json_block_t *b) {
+    /* whitespace bytes are the only ones found at their own low-nibble slot */
+    const __m128i ws_table = _mm_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100);
+    const __m128i lower = _mm_set1_epi8(0x20);
+
+    b->backslash = b->quote = b->whitespace = b->op = 0;
+
+    for (int i = 0; i < JSON_BLOCK_SIZE; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        /* [ and ] become { and } */
+        __m128i curly = _mm_or_si128(v, lower);
+
+        __m128i ws = _mm_cmpeq_epi8(_mm_shuffle_epi8(ws_table, v), v);
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(curly, _mm_set1_epi8('{')),
+                                               _mm_cmpeq_epi8(curly, _mm_set1_epi8('}'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')),
+                                               _mm_cmpeq_epi8(v, _mm_set1_epi8(':'))));
+
+        b->backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << i;
+        b->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << i;
+        b->whitespace |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << i;
+        b->op |= (uint64_t)(uint16_t)_mm_movemask_epi8(op) << i;
+    }
+}
+
+/* 16 bytes at a time, the tail that does not fill a register goes byte by byte. */
+static size_t scan_string_sse42(const uint8_t *p, size_t len) {
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        /* bytes up to 0x1F are left unchanged by the unsigned max */
+        __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                                    _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F)));
+        int mask = _mm_movemask_epi8(stop);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+
+    while (i < len && p[i] != '"' && p[i] != '\\' && p[i] >= 0x20)
+        i++;
+    return i;
+}
+
+/* Error bits of every byte pair ending in input, prev holds the 16 bytes before it. */
+static __m128i utf8_errors_sse42(__m128i input, __m128i prev) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+    __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+
+    const __m128i byte_1_high_table = _mm_loadu_si128((const __m128i *)json_utf8_byte_1_high);
+    const __m128i byte_1_low_table = _mm_loadu_si128((const __m128i *)json_utf8_byte_1_low);
+    const __m128i byte_2_high_table = _mm_loadu_si128((const __m128i *)json_utf8_byte_2_high);
+
+    __m128i byte_1_high = _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+    /* bit 7 set where a 3 or 4 byte lead two or three bytes back wants a continuation */
+    __m128i must_continue = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80)),
+                                         _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80)));
+    return _mm_xor_si128(_mm_and_si128(must_continue, _mm_set1_epi8((char)0x80)), special);
+}
+
+/* The last 16 bytes are zero padded, so a sequence cut by the end fails like one cut by ASCII. */
+static bool validate_utf8_sse42(const uint8_t *p, size_t len) {
+    /* nonzero where a lead in the last three bytes still needs continuations */
+    const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1),
+                                      (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m128i prev = _mm_setzero_si128(), incomplete = _mm_setzero_si128(), error = _mm_setzero_si128();
+    uint8_t tail[16] = {0};
+    size_t i = 0;
+
+    for (;;) {
+        __m128i v;
+        bool last = len - i < 16;
+
+        if (last) {
+            memcpy(tail, p + i, len - i);
+            v = _mm_loadu_si128((const __m128i *)tail);
+        } else {
+            v = _mm_loadu_si128((const __m128i *)(p + i));
+        }
+
+        if (!_mm_movemask_epi8(v)) {
+            error = _mm_or_si128(error, incomplete);
+        } else {
+            error = _mm_or_si128(error, utf8_errors_sse42(v, prev));
+            incomplete = _mm_subs_epu8(v, max);
+        }
+
+        if (last)
+            break;
+        prev = v;
+        i += 16;
+    }
+
+    return _mm_testz_si128(error, error);
+}
+#endif
+
+const struct json_kernels_t json_kernels_sse42 = {
+    .name = "sse4.2",
+#if defined(__SSE4_2__)
+    .classify_block = classify_sse42,
+    .scan_string = scan_string_sse42,
+    .validate_utf8 = validate_utf8_sse42,
+#else
+    .classify_block = NULL,
+    .scan_string = NULL,
+    .validate_utf8 = NULL,
+#endif
+};
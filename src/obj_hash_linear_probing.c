@@ -26,8 +26,8 @@ struct hashmap_map {
 };
 
 void hashmap_free(struct hashmap_map *m) {
-    if (m) free(m->data);
-    free(m);
+    if (m) json_free(m->data);
+    json_free(m);
 }
 
 /* Return the length of the hashmap */
@@ -35,10 +35,10 @@ size_t hashmap_length(struct hashmap_map *m) { return m ? m->size : 0; }
 size_t hashmap_capacity(struct hashmap_map *m) { return m ? m->table_size : 0; }
 
 struct hashmap_map *hashmap_new(size_t capacity) {
-    struct hashmap_map *m = (struct hashmap_map *)malloc(sizeof(struct hashmap_map));
+    struct hashmap_map *m = (struct hashmap_map *)json_malloc(sizeof(struct hashmap_map));
     if (!m) return NULL;
 
-    m->data = (struct hashmap_element *)calloc(capacity, sizeof(struct hashmap_element));
+    m->data = (struct hashmap_element *)json_calloc(capacity, sizeof(struct hashmap_element));
     if (!m->data) {
         hashmap_free(m);
         return NULL;
@@ -96,7 +96,7 @@ bool hashmap_rehash(struct hashmap_map *m, size_t new_size) {
     if (m->size > new_size) return false;
 
     /* Setup the new elements */
-    struct hashmap_element *temp = (struct hashmap_element *)calloc(new_size, sizeof(struct hashmap_element));
+    struct hashmap_element *temp = (struct hashmap_element *)json_calloc(new_size, sizeof(struct hashmap_element));
     if (!temp) return false;
 
     /* Update the array */
@@ -115,7 +115,7 @@ bool hashmap_rehash(struct hashmap_map *m, size_t new_size) {
         }
     }
 
-    free(curr);
+    json_free(curr);
 
     return true;
 }
@@ -269,6 +269,50 @@ void jsonext_obj_insert(union json_t *j, struct json_pair_t *pair) {
     hashmap_put(j->obj.pairs, key, pair);
 }
 
+bool jsonext_obj_reserve(union json_t *j, size_t length) {
+    size_t size = (size_t)(length / HASHMAP_FILL_FACTOR) + 1;
+
+    if (size < HASHMAP_MIN_SIZE)
+        size = HASHMAP_MIN_SIZE;
+    if (!j->obj.pairs) {
+        j->obj.pairs = hashmap_new(size);
+        return j->obj.pairs != NULL;
+    }
+    if (hashmap_capacity((struct hashmap_map *)j->obj.pairs) < size)
+        return hashmap_rehash((struct hashmap_map *)j->obj.pairs, size);
+    return true;
+}
+
+// one probe finds either the pair with this key or the free slot for it
+struct json_pair_t *jsonext_obj_emplace(union json_t *j, struct json_pair_t *pair) {
+    struct hashmap_map *m;
+    size_t index;
+
+    if (!j->obj.pairs) {
+        j->obj.pairs = hashmap_new(HASHMAP_MIN_SIZE);
+        if (!j->obj.pairs)
+            return NULL;
+    }
+    m = (struct hashmap_map *)j->obj.pairs;
+    if (m->size >= m->table_size * HASHMAP_FILL_FACTOR) {
+        hashmap_rehash(m, 2 * m->table_size);
+    }
+
+    index = hashmap_hash(m, pair->key);
+    if (index == m->table_size) {
+        return NULL;
+    }
+    if (m->data[index].in_use) {
+        return m->data[index].value;
+    }
+
+    m->data[index].value = pair;
+    m->data[index].key = pair->key;
+    m->data[index].in_use = 1;
+    m->size++;
+    return pair;
+}
+
 struct json_pair_t *jsonext_obj_get(union json_t *j, const char *key) {
 	if (j->obj.pairs) {
 		return hashmap_get(j->obj.pairs, key);
@@ -254,6 +254,22 @@ TEST(JsonCommonTest, JsonDumpsTerminalToken) {
     free(res);
 }
 
+TEST(JsonCommonTest, DumpsEscapedString) {
+    /* Arrange */
+    union json_t j = JSON_OBJECT;
+    json_set(&j, "a\"b", JSON_STRING("line\n\ttab \\ \"quote\" \x01 caf\xc3\xa9"));
+
+    /* Act */
+    char *res = json_dumps(j, .indent = -1);
+
+    /* Assert */
+    EXPECT_STREQ("{\"a\\\"b\": \"line\\n\\ttab \\\\ \\\"quote\\\" \\u0001 caf\xc3\xa9\"}", res);
+
+    /* Clean */
+    free(res);
+    json_clean(&j);
+}
+
 TEST(JsonCommonTest, DumpToFile) {
     /* Arrange */
     FILE *tempOutput = tmpfile();
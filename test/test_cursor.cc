@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "env.hh"
+
+static std::string cursor_str(struct json_cursor_t *c) {
+    const char *s;
+    size_t n;
+    return json_cursor_get_str(c, &s, &n) ? std::string(s, n) : "<none>";
+}
+
+TEST(JsonCursorTest, ReadsKnownSchema) {
+    /* Arrange */
+    const std::string data = "{\"id\": 42, \"skip\": {\"deep\": [1, [2, {\"]\": \"}\"}]]}, \"name\": \"a\\nb\","
+                             " \"ratio\": 0.25, \"big\": 18446744073709551615, \"ok\": true, \"none\": null}";
+    struct json_cursor_t *c = json_cursor_new(data.data(), data.size());
+    int64_t id;
+    uint64_t big;
+    double ratio;
+    bool ok;
+
+    /* Act & Assert */
+    EXPECT_EQ(JT_OBJECT, json_cursor_type(c));
+    ASSERT_TRUE(json_cursor_enter_object(c));
+    ASSERT_TRUE(json_cursor_find(c, "id"));
+    EXPECT_FALSE(json_cursor_get_str(c, NULL, NULL));
+    EXPECT_TRUE(json_cursor_get_i64(c, &id));
+    EXPECT_EQ(42, id);
+    ASSERT_TRUE(json_cursor_find(c, "name"));
+    EXPECT_EQ("a\nb", cursor_str(c));
+    ASSERT_TRUE(json_cursor_find(c, "big"));
+    EXPECT_FALSE(json_cursor_get_i64(c, &id));
+    EXPECT_TRUE(json_cursor_get_u64(c, &big));
+    EXPECT_EQ(UINT64_MAX, big);
+    // before the current member, found by wrapping around
+    ASSERT_TRUE(json_cursor_find(c, "ratio"));
+    EXPECT_TRUE(json_cursor_get_f64(c, &ratio));
+    EXPECT_DOUBLE_EQ(0.25, ratio);
+    ASSERT_TRUE(json_cursor_find(c, "ok"));
+    EXPECT_TRUE(json_cursor_get_bool(c, &ok));
+    EXPECT_TRUE(ok);
+    ASSERT_TRUE(json_cursor_find(c, "none"));
+    EXPECT_TRUE(json_cursor_get_null(c));
+    EXPECT_FALSE(json_cursor_next(c));
+    EXPECT_EQ(JSON_ERROR_NONE, c->error.code);
+
+    /* Clean */
+    json_cursor_free(c);
+}
+
+TEST(JsonCursorTest, MissingKeyKeepsPosition) {
+    /* Arrange */
+    const std::string data = "{\"a\": 1, \"b\": 2, \"c\": 3}";
+    struct json_cursor_t *c = json_cursor_new(data.data(), data.size());
+    const char *key;
+    size_t len;
+    int64_t v;
+
+    /* Act & Assert */
+    ASSERT_TRUE(json_cursor_enter_object(c));
+    EXPECT_FALSE(json_cursor_find(c, "x"));
+    ASSERT_TRUE(json_cursor_find(c, "b"));
+    EXPECT_FALSE(json_cursor_find(c, "x"));
+    ASSERT_TRUE(json_cursor_next(c));
+    ASSERT_TRUE(json_cursor_key(c, &key, &len));
+    EXPECT_EQ("c", std::string(key, len));
+    EXPECT_TRUE(json_cursor_find(c, "a"));
+    EXPECT_TRUE(json_cursor_get_i64(c, &v));
+    EXPECT_EQ(1, v);
+    EXPECT_EQ(JSON_ERROR_NONE, c->error.code);
+
+    /* Clean */
+    json_cursor_free(c);
+}
+
+TEST(JsonCursorTest, IteratesArrays) {
+    /* Arrange */
+    const std::string data = "[{\"v\": 1, \"k\\u0041\": \"x\"}, {\"w\": [9], \"v\": 2}, [], {\"v\": 3}]";
+    struct json_cursor_t *c = json_cursor_new(data.data(), data.size());
+    std::string keys;
+    int64_t sum = 0, v;
+    size_t count = 0;
+
+    /* Act */
+    ASSERT_TRUE(json_cursor_enter_array(c));
+    while (json_cursor_next(c)) {
+        count++;
+        if (!json_cursor_enter_object(c))
+            continue;
+        while (json_cursor_next(c)) {
+            const char *key;
+            size_t len;
+            json_cursor_key(c, &key, &len);
+            keys += std::string(key, len) + ",";
+            if (json_cursor_get_i64(c, &v))
+                sum += v;
+        }
+    }
+
+    /* Assert */
+    EXPECT_EQ(JSON_ERROR_NONE, c->error.code);
+    EXPECT_EQ(4u, count);
+    EXPECT_EQ(6, sum);
+    EXPECT_EQ("v,kA,w,v,v,", keys);
+    EXPECT_EQ(0u, c->depth);
+    EXPECT_EQ(JT_MISSING, json_cursor_type(c));
+
+    /* Clean */
+    json_cursor_free(c);
+}
+
+TEST(JsonCursorTest, GetValueBuildsSubtree) {
+    /* Arrange */
+    const std::string data = "{\"meta\": {\"n\": 1}, \"items\": [1, 2, {\"a\": \"b\"}]}";
+    struct json_cursor_t *c = json_cursor_new(data.data(), data.size(), .typed_numbers = true);
+    union json_t items;
+
+    /* Act */
+    ASSERT_TRUE(json_cursor_enter_object(c));
+    ASSERT_TRUE(json_cursor_find(c, "items"));
+    ASSERT_TRUE(json_cursor_get_value(c, &items));
+
+    /* Assert */
+    char *text = json_dumps(items, .indent = -1);
+    EXPECT_STREQ("[1, 2, {\"a\": \"b\"}]", text);
+    EXPECT_EQ(JT_INT, json_get(items, 0).type);
+    EXPECT_FALSE(json_cursor_next(c));
+
+    /* Clean */
+    free(text);
+    json_clean(&items);
+    json_cursor_free(c);
+}
+
+TEST(JsonCursorTest, SyntaxErrors) {
+    struct json_cursor_t *c;
+    int64_t v;
+
+    c = json_cursor_new("[1 2]", 5);
+    ASSERT_TRUE(json_cursor_enter_array(c));
+    EXPECT_TRUE(json_cursor_next(c));
+    EXPECT_FALSE(json_cursor_next(c));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, c->error.code);
+    EXPECT_EQ(3u, c->error.offset);
+    EXPECT_FALSE(json_cursor_enter_array(c));
+    json_cursor_free(c);
+
+    c = json_cursor_new("{\"a\": 01}", 9);
+    ASSERT_TRUE(json_cursor_enter_object(c));
+    ASSERT_TRUE(json_cursor_find(c, "a"));
+    EXPECT_FALSE(json_cursor_get_i64(c, &v));
+    EXPECT_EQ(JSON_ERROR_INVALID_NUMBER, c->error.code);
+    json_cursor_free(c);
+
+    c = json_cursor_new("{\"a\": [1, 2, 3", 14);
+    ASSERT_TRUE(json_cursor_enter_object(c));
+    EXPECT_FALSE(json_cursor_find(c, "b"));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_EOF, c->error.code);
+    json_cursor_free(c);
+
+    std::string deep = std::string(10, '[') + std::string(10, ']');
+    c = json_cursor_new(deep.data(), deep.size(), .max_depth = 3);
+    EXPECT_TRUE(json_cursor_enter_array(c));
+    EXPECT_TRUE(json_cursor_next(c));
+    EXPECT_TRUE(json_cursor_enter_array(c));
+    EXPECT_TRUE(json_cursor_next(c));
+    EXPECT_TRUE(json_cursor_enter_array(c));
+    EXPECT_TRUE(json_cursor_next(c));
+    EXPECT_FALSE(json_cursor_enter_array(c));
+    EXPECT_EQ(JSON_ERROR_DEPTH, c->error.code);
+    json_cursor_free(c);
+}
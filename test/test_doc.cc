@@ -0,0 +1,248 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "env.hh"
+
+TEST(JsonDocTest, DocDeserialize) {
+    /* Arrange */
+    const char *data = "{\"name\": \"unionJson\", \"tags\": [\"c\", \"json\"], \"version\": {\"major\": 0, \"minor\": 1}}";
+
+    /* Act */
+    struct json_doc_t *doc = json_doc_deserialize(data);
+
+    /* Assert */
+    ASSERT_NE(nullptr, doc);
+    ASSERT_EQ(JT_OBJECT, doc->root.type);
+    EXPECT_STREQ("unionJson", json_get(doc->root, "name").text);
+    EXPECT_EQ(2, json_length(json_get(doc->root, "tags")));
+    EXPECT_STREQ("json", json_get(json_get(doc->root, "tags"), 1).text);
+    EXPECT_STREQ("1", json_get(json_get(doc->root, "version"), "minor").text);
+    EXPECT_NE(nullptr, doc->arena.chunks);
+    EXPECT_EQ(nullptr, active_doc);
+
+    /* Clean */
+    json_doc_free(doc);
+}
+
+TEST(JsonDocTest, DocAllocatesFromArena) {
+    /* Arrange */
+    struct json_doc_t *doc = json_doc_new();
+
+    /* Act */
+    json_doc_begin(doc);
+    char *a = (char *)json_malloc(1);
+    char *b = (char *)json_malloc(24);
+    char *c = (char *)json_calloc(4, 8);
+    json_free(a);
+    json_doc_end(doc);
+
+    /* Assert */
+    EXPECT_EQ(0u, (uintptr_t)a % __alignof__(max_align_t));
+    EXPECT_EQ(0u, (uintptr_t)b % __alignof__(max_align_t));
+    EXPECT_EQ(b + 32, c);
+    for (int i = 0; i < 32; i++) {
+        EXPECT_EQ(0, c[i]);
+    }
+    EXPECT_EQ(nullptr, doc->arena.chunks->next);
+
+    /* Clean */
+    json_doc_free(doc);
+}
+
+TEST(JsonDocTest, DocLargeAllocation) {
+    /* Arrange */
+    struct json_doc_t *doc = json_doc_new();
+    std::string text = "[\"" + std::string(3 * JSON_ARENA_MAX_CHUNK, 'x') + "\", 1]";
+
+    /* Act */
+    doc->root = json_deserialize_with(text.c_str(), .doc = doc);
+
+    /* Assert */
+    ASSERT_EQ(JT_ARRAY, doc->root.type);
+    EXPECT_EQ(3u * JSON_ARENA_MAX_CHUNK, strlen(json_get(doc->root, 0).text));
+    EXPECT_STREQ("1", json_get(doc->root, 1).text);
+
+    /* Clean */
+    json_doc_free(doc);
+}
+
+TEST(JsonDocTest, DocBuilderSession) {
+    /* Arrange */
+    struct json_doc_t *doc = json_doc_new();
+
+    /* Act */
+    json_doc_begin(doc);
+    doc->root = JSON_OBJECT;
+    json_set(&doc->root, "name", "hello");
+    json_set(&doc->root, "name", "world");
+    json_set(&doc->root, "list", JSON_ARRAY);
+    for (int i = 0; i < 100; i++) {
+        json_append(json_getp(doc->root, "list"), i);
+    }
+    json_delete(json_getp(doc->root, "list"), 0);
+    json_set(&doc->root, "gone", 1);
+    json_delete(&doc->root, "gone");
+    json_doc_end(doc);
+
+    /* Assert */
+    EXPECT_EQ(2, json_length(doc->root));
+    EXPECT_STREQ("world", json_get(doc->root, "name").text);
+    EXPECT_EQ(99, json_length(json_get(doc->root, "list")));
+    EXPECT_EQ(1, json_get(json_get(doc->root, "list"), 0).i64);
+
+    /* Clean */
+    json_doc_free(doc);
+}
+
+TEST(JsonDocTest, DocNestedSessions) {
+    /* Arrange */
+    struct json_doc_t *outer = json_doc_new();
+    struct json_doc_t *inner = json_doc_new();
+
+    /* Act & Assert */
+    json_doc_begin(outer);
+    json_doc_begin(inner);
+    EXPECT_EQ(inner, active_doc);
+    json_doc_end(inner);
+    EXPECT_EQ(outer, active_doc);
+    json_doc_end(outer);
+    EXPECT_EQ(nullptr, active_doc);
+
+    /* heap values are not affected by a finished session */
+    union json_t j = json_deserialize("[\"heap\"]");
+    EXPECT_STREQ("heap", json_get(j, 0).text);
+
+    /* Clean */
+    json_clean(&j);
+    json_doc_free(inner);
+    json_doc_free(outer);
+}
+
+TEST(JsonDocTest, DocDeserializeInSitu) {
+    /* Arrange */
+    char buffer[] = "{\"name\": \"plain\", \"esc\\\"aped\": [\"a\\nb\", \"\\u00e9\", 1.5, \"\"]}";
+    const char *end = buffer + sizeof(buffer);
+
+    /* Act */
+    struct json_doc_t *doc = json_doc_deserialize_in_situ(buffer);
+
+    /* Assert */
+    ASSERT_EQ(JT_OBJECT, doc->root.type);
+    union json_t name = json_get(doc->root, "name");
+    union json_t arr = json_get(doc->root, "esc\"aped");
+    EXPECT_STREQ("plain", name.text);
+    EXPECT_STREQ("a\nb", json_get(arr, 0).text);
+    EXPECT_STREQ("\xc3\xa9", json_get(arr, 1).text);
+    EXPECT_STREQ("1.5", json_get(arr, 2).text);
+    EXPECT_STREQ("", json_get(arr, 3).text);
+
+    /* strings and keys point into the buffer, numbers are copied */
+    EXPECT_TRUE(name.text > buffer && name.text < end);
+    EXPECT_TRUE(json_get(arr, 0).text > buffer && json_get(arr, 0).text < end);
+    EXPECT_TRUE(json_obj_iter_first(doc->root)->key > buffer && json_obj_iter_first(doc->root)->key < end);
+    EXPECT_FALSE(json_get(arr, 2).text > buffer && json_get(arr, 2).text < end);
+
+    /* Clean */
+    json_doc_free(doc);
+}
+
+TEST(JsonDocTest, DocInSituMatchesCopy) {
+    /* Arrange: strings with escapes that cross 64-byte blocks */
+    std::string text = "[";
+    for (int i = 0; i < 200; i++) {
+        text += i ? ", " : "";
+        text += "{\"key " + std::to_string(i) + "\\\\\": \"" + std::string(i % 70, 'x') + "\\\"]\\u0041 ,\"}";
+    }
+    text += "]";
+    std::vector<char> buffer(text.begin(), text.end());
+    buffer.push_back('\0');
+
+    /* Act */
+    union json_t copy = json_deserialize(text.c_str());
+    struct json_doc_t *doc = json_doc_deserialize_in_situ(buffer.data());
+
+    /* Assert */
+    ASSERT_EQ(200, json_length(doc->root));
+    char *expected = json_dumps(copy, .indent = -1);
+    char *actual = json_dumps(doc->root, .indent = -1);
+    EXPECT_STREQ(expected, actual);
+    EXPECT_STREQ("key 7\\", json_obj_iter_first(json_get(doc->root, 7))->key);
+    EXPECT_STREQ("xxxxxxx\"]A ,", json_get(json_get(doc->root, 7), "key 7\\").text);
+
+    /* Clean */
+    free(expected);
+    free(actual);
+    json_clean(&copy);
+    json_doc_free(doc);
+}
+
+TEST(JsonDocTest, InSituNeedsDoc) {
+    /* Arrange */
+    char buffer[] = "[\"a\"]";
+
+    /* Act */
+    union json_t j = json_deserialize_with(buffer, .in_situ = true);
+
+    /* Assert: strings are copied, the buffer is untouched */
+    EXPECT_STREQ("a", json_get(j, 0).text);
+    EXPECT_STREQ("[\"a\"]", buffer);
+
+    /* Clean */
+    json_clean(&j);
+}
+
+TEST(JsonDocTest, DocFile) {
+    /* Arrange */
+    const char *filename = "/tmp/test_doc_file.json";
+    const char *data = "{\"name\": \"mapped\", \"list\": [\"a\\tb\", 2]}";
+    FILE *fp = fopen(filename, "w");
+    ASSERT_TRUE(fp != nullptr);
+    fputs(data, fp);
+    fclose(fp);
+
+    /* Act */
+    struct json_doc_t *doc = json_doc_file(filename);
+
+    /* Assert */
+    ASSERT_NE(nullptr, doc);
+    ASSERT_EQ(JT_OBJECT, doc->root.type);
+    union json_t name = json_get(doc->root, "name");
+    EXPECT_STREQ("mapped", name.text);
+    EXPECT_STREQ("a\tb", json_get(json_get(doc->root, "list"), 0).text);
+
+    /* strings point into the mapping, the file is untouched */
+    ASSERT_NE(nullptr, doc->map);
+    EXPECT_TRUE(name.text > doc->map && name.text < doc->map + doc->map_len);
+    char buffer[128] = {0};
+    fp = fopen(filename, "r");
+    ASSERT_TRUE(fp != nullptr);
+    EXPECT_EQ(strlen(data), fread(buffer, 1, sizeof(buffer), fp));
+    fclose(fp);
+    EXPECT_STREQ(data, buffer);
+
+    /* Clean */
+    json_doc_free(doc);
+    ASSERT_EQ(0, remove(filename));
+}
+
+TEST(JsonDocTest, DocFileNotMappable) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_EQ(9, write(fds[1], "[\"pipe\"]\n", 9));
+    close(fds[1]);
+    std::string path = "/dev/fd/" + std::to_string(fds[0]);
+
+    struct json_doc_t *doc = json_doc_file(path.c_str());
+
+    ASSERT_NE(nullptr, doc);
+    EXPECT_EQ(nullptr, doc->map);
+    EXPECT_STREQ("pipe", json_get(doc->root, 0).text);
+
+    close(fds[0]);
+    json_doc_free(doc);
+    EXPECT_EQ(nullptr, json_doc_file("/tmp/does_not_exist.json"));
+}
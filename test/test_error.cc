@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "env.hh"
+
+struct error_case_t {
+    const char *text;
+    enum json_error_code code;
+    size_t offset;
+};
+
+static const struct error_case_t error_cases[] = {
+    {"", JSON_ERROR_UNEXPECTED_EOF, 0},
+    {"   ", JSON_ERROR_UNEXPECTED_EOF, 3},
+    {"[1, 2", JSON_ERROR_UNEXPECTED_EOF, 5},
+    {"{\"a\": 1", JSON_ERROR_UNEXPECTED_EOF, 7},
+    {"[1 2]", JSON_ERROR_UNEXPECTED_TOKEN, 3},
+    {"[1, 2,]", JSON_ERROR_UNEXPECTED_TOKEN, 6},
+    {"{\"a\": 1,}", JSON_ERROR_UNEXPECTED_TOKEN, 8},
+    {"{\"a\" 1}", JSON_ERROR_UNEXPECTED_TOKEN, 5},
+    {"{1: 2}", JSON_ERROR_UNEXPECTED_TOKEN, 1},
+    {"[,]", JSON_ERROR_UNEXPECTED_TOKEN, 1},
+    {"]", JSON_ERROR_UNEXPECTED_TOKEN, 0},
+    {"[1] 2", JSON_ERROR_TRAILING_DATA, 4},
+    {"{} {}", JSON_ERROR_TRAILING_DATA, 3},
+    {"[1] x", JSON_ERROR_INVALID_CHAR, 4},
+    {"[1, @]", JSON_ERROR_INVALID_CHAR, 4},
+    {"[truex]", JSON_ERROR_INVALID_CHAR, 5},
+    {"[tru]", JSON_ERROR_INVALID_LITERAL, 1},
+    {"nul", JSON_ERROR_INVALID_LITERAL, 0},
+    {"[01]", JSON_ERROR_INVALID_NUMBER, 1},
+    {"[+1]", JSON_ERROR_INVALID_NUMBER, 1},
+    {"[1.]", JSON_ERROR_INVALID_NUMBER, 1},
+    {"[-]", JSON_ERROR_INVALID_NUMBER, 1},
+    {"[1e+]", JSON_ERROR_INVALID_NUMBER, 1},
+    {"[\"abc", JSON_ERROR_INVALID_STRING, 5},
+    {"[\"a\nb\"]", JSON_ERROR_INVALID_STRING, 3},
+    {"[\"a\tb\"]", JSON_ERROR_INVALID_STRING, 3},
+    {"[\"a\\qb\"]", JSON_ERROR_INVALID_ESCAPE, 1},
+    {"{\"\\ud800\": 1}", JSON_ERROR_INVALID_ESCAPE, 1},
+};
+
+TEST(JsonErrorTest, DeserializeReportsError) {
+    for (const struct error_case_t &c : error_cases) {
+        struct json_error_t error = {JSON_ERROR_NONE, 0, 0, 0};
+
+        union json_t j = json_deserialize_with(c.text, .error = &error);
+
+        EXPECT_EQ(JT_MISSING, j.type) << c.text;
+        EXPECT_EQ(c.code, error.code) << c.text << ": " << json_error2str(error.code);
+        EXPECT_EQ(c.offset, error.offset) << c.text;
+    }
+}
+
+TEST(JsonErrorTest, ParsersAgreeOnError) {
+    for (const struct error_case_t &c : error_cases) {
+        void (*parsers[])(struct json_parser_context_t *) = {json_parse, json_parse_recursive};
+
+        for (auto parse : parsers) {
+            for (bool on_demand : {true, false}) {
+                struct json_lexer_context_t *lexer = json_create_lexer(c.text);
+                struct json_parser_context_t *parser = json_create_parser(lexer);
+
+                if (!on_demand)
+                    json_execute_lexer(lexer);
+                parser->on_demand = on_demand;
+                parse(parser);
+
+                EXPECT_EQ(JT_MISSING, parser->root.type) << c.text;
+                EXPECT_EQ(c.code, parser->error.code) << c.text << (on_demand ? " on demand" : " tape");
+                EXPECT_EQ(c.offset, parser->error.offset) << c.text;
+
+                json_delete_lexer(lexer);
+                json_delete_parser(parser);
+            }
+        }
+    }
+}
+
+TEST(JsonErrorTest, ErrorRowColumn) {
+    /* Arrange */
+    const char *data = "{\n  \"a\": [1, 2],\n  \"b\": tru\n}";
+    struct json_error_t error;
+
+    /* Act */
+    union json_t j = json_deserialize_with(data, .error = &error);
+
+    /* Assert */
+    EXPECT_EQ(JT_MISSING, j.type);
+    EXPECT_EQ(JSON_ERROR_INVALID_LITERAL, error.code);
+    EXPECT_EQ(24u, error.offset);
+    EXPECT_EQ(3u, error.row);
+    EXPECT_EQ(8u, error.column);
+}
+
+TEST(JsonErrorTest, NoErrorOnSuccess) {
+    struct json_error_t error = {JSON_ERROR_INVALID_CHAR, 1, 1, 1};
+
+    union json_t j = json_deserialize_with("{\"a\": [1, {\"b\": null}]}", .error = &error);
+
+    EXPECT_EQ(JT_OBJECT, j.type);
+    EXPECT_EQ(JSON_ERROR_NONE, error.code);
+
+    json_clean(&j);
+}
+
+TEST(JsonErrorTest, PartialTreeIsFreed) {
+    /* Runs under the leak checker: keys, strings and containers built before the error are released */
+    const char *data[] = {
+        "{\"a\": [\"x\", {\"b\": \"y\"}], \"c\": {\"d\": [1, 2, 3], \"e\": \"z\" \"f\"}}",
+        "[[\"a\", [\"b\", [\"c\", \"\\x\"]]]]",
+        "{\"k\": {\"k\": {\"k\": ",
+    };
+
+    for (const char *text : data) {
+        union json_t j = json_deserialize_with(text, .typed_numbers = true);
+        EXPECT_EQ(JT_MISSING, j.type) << text;
+    }
+
+    std::string deep = std::string(2000, '[') + "\"leaf\"" + std::string(2000, ']');
+    struct json_error_t error;
+    union json_t j = json_deserialize_with(deep.c_str(), .error = &error);
+    EXPECT_EQ(JT_MISSING, j.type);
+    EXPECT_EQ(JSON_ERROR_DEPTH, error.code);
+    EXPECT_EQ(1024u, error.offset);
+}
+
+TEST(JsonErrorTest, ErrorToString) {
+    EXPECT_STREQ("no error", json_error2str(JSON_ERROR_NONE));
+    EXPECT_STREQ("trailing data", json_error2str(JSON_ERROR_TRAILING_DATA));
+    EXPECT_STREQ("nesting too deep", json_error2str(JSON_ERROR_DEPTH));
+    EXPECT_EQ(nullptr, json_error2str(JSON_ERROR_CODE_SIZE));
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "env.hh"
+
+/* A temporary source file and the path of its index, both removed at the end of the test. */
+class JsonIndexTest : public ::testing::Test {
+  protected:
+    char path[32] = "/tmp/json_index_XXXXXX";
+    std::string index_path;
+
+    void write_source(const std::string &data) {
+        strcpy(path, "/tmp/json_index_XXXXXX");
+        int fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ((ssize_t)data.size(), write(fd, data.data(), data.size()));
+        close(fd);
+        index_path = std::string(path) + ".idx";
+    }
+
+    void TearDown() override {
+        unlink(path);
+        unlink(index_path.c_str());
+    }
+};
+
+static std::string dump_value(union json_t j) {
+    char *text = json_dumps(j, .indent = -1);
+    std::string s = text;
+    free(text);
+    return s;
+}
+
+TEST_F(JsonIndexTest, ArrayElements) {
+    /* Arrange */
+    write_source(" [ {\"s\": \"a,]\"},\n  [1, [2]] , \"three\",4, null ]\n");
+    ASSERT_TRUE(json_index_build(path, index_path.c_str()));
+
+    /* Act */
+    struct json_index_t *idx = json_index_open(path, index_path.c_str(), true);
+
+    /* Assert */
+    ASSERT_TRUE(idx != NULL);
+    ASSERT_EQ(5u, idx->count);
+    const char *expected[] = {"{\"s\": \"a,]\"}", "[1, [2]]", "\"three\"", "4", "null"};
+    for (size_t i = 0; i < 5; i++) {
+        union json_t j = json_index_get(idx, i);
+        EXPECT_EQ(expected[i], dump_value(j)) << i;
+        json_clean(&j);
+    }
+    union json_t j = json_index_get(idx, 3, .typed_numbers = true);
+    EXPECT_EQ(JT_INT, j.type);
+    EXPECT_EQ(JT_MISSING, json_index_get(idx, 5).type);
+    EXPECT_EQ(JT_MISSING, json_index_get_key(idx, "id").type);
+
+    /* Clean */
+    json_index_close(idx);
+}
+
+TEST_F(JsonIndexTest, ObjectMembers) {
+    /* Arrange */
+    write_source("{\"a\": [1, 2], \"b\\u0041\": {\"x\": true}, \"c\": \"s\", \"a\": 3}");
+    ASSERT_TRUE(json_index_build(path, index_path.c_str()));
+    struct json_index_t *idx = json_index_open(path, index_path.c_str(), false);
+    ASSERT_TRUE(idx != NULL);
+
+    /* Act & Assert */
+    EXPECT_EQ(4u, idx->count);
+    union json_t j = json_index_get_key(idx, "bA");
+    EXPECT_EQ("{\"x\": true}", dump_value(j));
+    json_clean(&j);
+
+    // the last of repeated keys wins
+    j = json_index_get_key(idx, "a");
+    EXPECT_EQ("3", dump_value(j));
+    json_clean(&j);
+
+    j = json_index_get(idx, 0);
+    EXPECT_EQ("[1, 2]", dump_value(j));
+    json_clean(&j);
+
+    EXPECT_EQ(JT_MISSING, json_index_get_key(idx, "missing").type);
+
+    /* Clean */
+    json_index_close(idx);
+}
+
+TEST_F(JsonIndexTest, EmptyRoot) {
+    write_source("[ ]");
+    ASSERT_TRUE(json_index_build(path, index_path.c_str()));
+
+    struct json_index_t *idx = json_index_open(path, index_path.c_str(), true);
+    ASSERT_TRUE(idx != NULL);
+    EXPECT_EQ(0u, idx->count);
+    EXPECT_EQ(JT_MISSING, json_index_get(idx, 0).type);
+    json_index_close(idx);
+}
+
+TEST_F(JsonIndexTest, StaleIndex) {
+    /* Arrange */
+    write_source("[1, 2, 3]");
+    ASSERT_TRUE(json_index_build(path, index_path.c_str()));
+    struct stat st;
+    ASSERT_EQ(0, stat(path, &st));
+
+    /* Act: same size and time, other content */
+    int fd = open(path, O_WRONLY);
+    ASSERT_EQ(9, pwrite(fd, "[1, 2, 4]", 9, 0));
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    ASSERT_EQ(0, futimens(fd, times));
+    close(fd);
+
+    /* Assert: only the checksum notices */
+    struct json_index_t *idx = json_index_open(path, index_path.c_str(), false);
+    ASSERT_TRUE(idx != NULL);
+    json_index_close(idx);
+    EXPECT_TRUE(json_index_open(path, index_path.c_str(), true) == NULL);
+
+    // a different size is always noticed
+    fd = open(path, O_WRONLY | O_APPEND);
+    ASSERT_EQ(1, write(fd, " ", 1));
+    close(fd);
+    EXPECT_TRUE(json_index_open(path, index_path.c_str(), false) == NULL);
+}
+
+TEST_F(JsonIndexTest, CannotIndex) {
+    write_source("\"scalar\"");
+    EXPECT_FALSE(json_index_build(path, index_path.c_str()));
+    unlink(path);
+
+    write_source("[1, 2,]");
+    EXPECT_FALSE(json_index_build(path, index_path.c_str()));
+
+    // not an index file
+    EXPECT_TRUE(json_index_open(path, path, false) == NULL);
+    EXPECT_FALSE(json_index_build("/tmp/json_index_does_not_exist", index_path.c_str()));
+}
+
+TEST_F(JsonIndexTest, MemberErrorOffset) {
+    /* Arrange: the index is built first, then the file changes without the time */
+    write_source("{\"a\": 1, \"b\": [1, 2]}");
+    ASSERT_TRUE(json_index_build(path, index_path.c_str()));
+    struct stat st;
+    ASSERT_EQ(0, stat(path, &st));
+    int fd = open(path, O_WRONLY);
+    ASSERT_EQ(1, pwrite(fd, "x", 1, 18));
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    ASSERT_EQ(0, futimens(fd, times));
+    close(fd);
+    struct json_index_t *idx = json_index_open(path, index_path.c_str(), false);
+    ASSERT_TRUE(idx != NULL);
+    struct json_error_t error;
+
+    /* Act */
+    union json_t j = json_index_get_key(idx, "b", .error = &error);
+
+    /* Assert */
+    EXPECT_EQ(JT_MISSING, j.type);
+    EXPECT_EQ(JSON_ERROR_INVALID_CHAR, error.code);
+    EXPECT_EQ(18u, error.offset);
+
+    /* Clean */
+    json_index_close(idx);
+}
@@ -1,8 +1,12 @@
+#include <algorithm>
 #include <cstddef>
 #include <gtest/gtest.h>
+#include <string>
+#include <vector>
 
 #include "env.hh"
 #include "json.h"
+#include "json_simd.h"
 
 TEST(JsonLexerTest, LexerType2Str) {
     for (int i = JLT_MISSING; i <= JLT_LEXER_TOKEN_SIZE; i++) {
@@ -23,11 +27,12 @@ TEST(JsonLexerTest, CreateLexer) {
     EXPECT_STREQ(str, lexer->from_string);
     EXPECT_EQ(strlen(str), lexer->from_string_len);
     EXPECT_EQ(0, lexer->offset);
-    EXPECT_EQ(1, lexer->column);
-    EXPECT_EQ(1, lexer->row);
+    EXPECT_EQ(NULL, lexer->line_starts);
+    EXPECT_EQ(0, lexer->line_count);
     EXPECT_EQ(0, lexer->tokens.length);
     EXPECT_EQ(0, lexer->tokens.capacity);
     EXPECT_EQ(NULL, lexer->tokens.list);
+    EXPECT_EQ(NULL, lexer->tokens.lengths);
 
     /* Clean */
     json_delete_lexer(lexer);
@@ -55,13 +60,14 @@ TEST(JsonLexerTest, ExecuteLexer) {
     EXPECT_EQ(tokens_len, lexer->tokens.length);
 
     for (int i = 0; i < tokens_len; i++) {
-        EXPECT_EQ(tokens[i].type, lexer->tokens.list[i].type) << "Case: " << i;
-        EXPECT_EQ(tokens[i].text, lexer->tokens.list[i].text) << "Case: " << i; // only check its address
-        EXPECT_EQ(tokens[i].index, lexer->tokens.list[i].index) << "Case: " << i;
-        EXPECT_EQ(tokens[i].start, lexer->tokens.list[i].start) << "Case: " << i;
-        EXPECT_EQ(tokens[i].end, lexer->tokens.list[i].end) << "Case: " << i;
-        EXPECT_EQ(tokens[i].column, lexer->tokens.list[i].column) << "Case: " << i;
-        EXPECT_EQ(tokens[i].row, lexer->tokens.list[i].row) << "Case: " << i;
+        struct json_lexer_token_t token = json_lexer_token_at(lexer, i);
+        EXPECT_EQ(tokens[i].type, token.type) << "Case: " << i;
+        EXPECT_EQ(tokens[i].text, token.text) << "Case: " << i; // only check its address
+        EXPECT_EQ(tokens[i].index, token.index) << "Case: " << i;
+        EXPECT_EQ(tokens[i].start, token.start) << "Case: " << i;
+        EXPECT_EQ(tokens[i].end, token.end) << "Case: " << i;
+        EXPECT_EQ(tokens[i].column, token.column) << "Case: " << i;
+        EXPECT_EQ(tokens[i].row, token.row) << "Case: " << i;
     }
 
     /* Clean */
@@ -119,18 +125,19 @@ TEST(JsonLexerTest, ExecuteLexerSingleToken) {
         /* Assert */
         EXPECT_EQ(1, lexer->tokens.length) << "Case: " << i;
         EXPECT_LE(1, lexer->tokens.capacity) << "Case: " << i;
-        EXPECT_EQ(testcases[i].token.type, lexer->tokens.list[0].type) << "Case: " << i;
-        EXPECT_EQ(testcases[i].token.index, lexer->tokens.list[0].index) << "Case: " << i;
-        EXPECT_EQ(testcases[i].token.start, lexer->tokens.list[0].start) << "Case: " << i;
-        EXPECT_EQ(testcases[i].token.end, lexer->tokens.list[0].end) << "Case: " << i;
-        EXPECT_EQ(testcases[i].token.column, lexer->tokens.list[0].column) << "Case: " << i;
-        EXPECT_EQ(testcases[i].token.row, lexer->tokens.list[0].row) << "Case: " << i;
+        struct json_lexer_token_t token = json_lexer_token_at(lexer, 0);
+        EXPECT_EQ(testcases[i].token.type, token.type) << "Case: " << i;
+        EXPECT_EQ(testcases[i].token.index, token.index) << "Case: " << i;
+        EXPECT_EQ(testcases[i].token.start, token.start) << "Case: " << i;
+        EXPECT_EQ(testcases[i].token.end, token.end) << "Case: " << i;
+        EXPECT_EQ(testcases[i].token.column, token.column) << "Case: " << i;
+        EXPECT_EQ(testcases[i].token.row, token.row) << "Case: " << i;
 
         size_t expect_length = testcases[i].token.end - testcases[i].token.start;
         char *expect_prefix_str = json_strndup(&testcases[i].str[testcases[i].token.start], expect_length);
 
-        size_t actual_length = lexer->tokens.list[0].end - lexer->tokens.list[0].start;
-        char *actual_prefix_str = json_strndup(lexer->tokens.list[0].text, actual_length);
+        size_t actual_length = token.end - token.start;
+        char *actual_prefix_str = json_strndup(token.text, actual_length);
         
         EXPECT_STREQ(expect_prefix_str, actual_prefix_str) << "Case: " << i;
 
@@ -141,3 +148,250 @@ TEST(JsonLexerTest, ExecuteLexerSingleToken) {
     }
 }
 
+
+/* Byte-at-a-time reference of the structural index */
+static std::vector<size_t> reference_structurals(const char *s, size_t len) {
+    std::vector<size_t> res;
+    bool in_string = false, escaped = false, prev_scalar = false;
+
+    for (size_t i = 0; i < len; i++) {
+        char c = s[i];
+        bool is_escaped = escaped;
+        bool is_op = strchr("{}[],:", c) && c != '\0';
+        bool is_ws = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        bool is_scalar = !is_op && !is_ws && c != '"';
+        bool is_quote = c == '"' && !is_escaped;
+        escaped = c == '\\' && !is_escaped;
+
+        if (in_string) {
+            if (is_quote)
+                in_string = false;
+        } else if (is_quote) {
+            res.push_back(i);
+            in_string = true;
+        } else if (is_op || (is_scalar && !prev_scalar)) {
+            res.push_back(i);
+        }
+        prev_scalar = is_scalar;
+    }
+    return res;
+}
+
+static std::vector<size_t> stage1_structurals(const char *s, size_t len) {
+    std::vector<size_t> res;
+    struct json_stage1_t stage1 = {0};
+    uint8_t block[JSON_BLOCK_SIZE];
+
+    for (size_t base = 0; base < len; base += JSON_BLOCK_SIZE) {
+        size_t n = std::min<size_t>(JSON_BLOCK_SIZE, len - base);
+        memset(block, ' ', sizeof(block));
+        memcpy(block, s + base, n);
+        for (uint64_t bits = json_stage1_block(&stage1, block); bits; bits &= bits - 1) {
+            res.push_back(base + __builtin_ctzll(bits));
+        }
+    }
+    return res;
+}
+
+TEST(JsonLexerTest, StructuralIndex) {
+    /* Arrange */
+    const char *str = "{ \"a\\\"b\" : [1, -2.5e3, true], \"c\\\\\":null,\"d\":\"x,y:{z}\" }";
+
+    /* Act */
+    std::vector<size_t> actual = stage1_structurals(str, strlen(str));
+
+    /* Assert */
+    std::vector<size_t> expect = { 0, 2, 9, 11, 12, 13, 15, 21, 23, 27, 28, 30, 35, 36, 40, 41, 44, 45, 55 };
+    EXPECT_EQ(expect, actual) << "Kernel: " << json_simd_kernel_name();
+}
+
+TEST(JsonLexerTest, StructuralIndexAcrossBlocks) {
+    /* Arrange */
+    const char alphabet[] = "\"\"\\\\{}[],: \na1t";
+    srand(42);
+
+    for (int round = 0; round < 500; round++) {
+        std::string str;
+        size_t len = rand() % 300;
+        for (size_t i = 0; i < len; i++) {
+            str.push_back(alphabet[rand() % (sizeof(alphabet) - 1)]);
+        }
+
+        /* Act */
+        std::vector<size_t> actual = stage1_structurals(str.c_str(), str.size());
+
+        /* Assert */
+        ASSERT_EQ(reference_structurals(str.c_str(), str.size()), actual) << "Input: " << str;
+    }
+}
+
+TEST(JsonLexerTest, PositionFromLineIndex) {
+    /* Arrange */
+    const char *str = "{\n  \"a\": [1,\n\n    2],\n  \"b\": null\n}\n";
+    size_t len = strlen(str);
+    struct json_lexer_context_t *lexer = json_create_lexer(str);
+    std::vector<size_t> offsets;
+
+    for (size_t i = 0; i <= len; i++)
+        offsets.push_back(i);
+    // far offsets first, then nearer ones from the index built so far
+    std::reverse(offsets.begin(), offsets.begin() + len / 2);
+
+    for (size_t offset : offsets) {
+        size_t expect_row = 1, expect_column = 1, row, column;
+        for (size_t i = 0; i < offset; i++) {
+            expect_column = str[i] == '\n' ? 1 : expect_column + 1;
+            expect_row += str[i] == '\n';
+        }
+
+        /* Act */
+        json_lexer_position(lexer, offset, &row, &column);
+
+        /* Assert */
+        EXPECT_EQ(expect_row, row) << offset;
+        EXPECT_EQ(expect_column, column) << offset;
+    }
+    EXPECT_EQ(6u, lexer->line_count);
+
+    /* Clean */
+    json_delete_lexer(lexer);
+}
+
+TEST(JsonLexerTest, ByteClassTable) {
+    for (int c = 0; c < 256; c++) {
+        enum json_char_class_t expect = JCC_INVALID;
+        const char *at = c ? strchr(" \t\r\n{}[],:\"-+.0123456789eEtfn", c) : NULL;
+
+        if (at) {
+            const enum json_char_class_t classes[] = {
+                JCC_SPACE, JCC_SPACE, JCC_SPACE, JCC_SPACE, JCC_LPAIR, JCC_RPAIR, JCC_LARRAY, JCC_RARRAY, JCC_COMMA,
+                JCC_COLON, JCC_QUOTE, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER,
+                JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_NUMBER, JCC_EXPONENT,
+                JCC_EXPONENT, JCC_TRUE, JCC_FALSE, JCC_NULL,
+            };
+            expect = classes[at - " \t\r\n{}[],:\"-+.0123456789eEtfn"];
+        }
+
+        EXPECT_EQ(expect, char_class[c]) << c;
+    }
+}
+
+TEST(JsonLexerTest, KernelsAgreeWithScalar) {
+    /* Arrange */
+    const struct json_kernels_t *kernels[] = {&json_kernels_sse42, &json_kernels_avx2, &json_kernels_avx512};
+    std::string active = json_simd_kernel_name();
+    uint8_t block[JSON_BLOCK_SIZE];
+    srand(7);
+
+    for (const struct json_kernels_t *k : kernels) {
+        if (!json_simd_use(k->name))
+            continue;
+
+        for (int round = 0; round < 2000; round++) {
+            struct json_block_t expect, actual;
+            for (size_t i = 0; i < sizeof(block); i++)
+                block[i] = round % 2 ? "{}[],:\" \t\n\r\\a\x80\xff"[rand() % 16] : (uint8_t)rand();
+
+            /* Act */
+            json_kernels_scalar.classify_block(block, &expect);
+            json_classify_block(block, &actual);
+
+            /* Assert */
+            ASSERT_EQ(expect.backslash, actual.backslash) << k->name;
+            ASSERT_EQ(expect.quote, actual.quote) << k->name;
+            ASSERT_EQ(expect.whitespace, actual.whitespace) << k->name;
+            ASSERT_EQ(expect.op, actual.op) << k->name;
+
+            // plain content with at most one byte to stop at
+            size_t len = rand() % (sizeof(block) + 1);
+            memset(block, 'a' + round % 26, sizeof(block));
+            block[rand() % sizeof(block)] = "\"\\\x1f\x01\x7f\xff"[rand() % 6];
+            ASSERT_EQ(json_kernels_scalar.scan_string(block, len), json_scan_string(block, len)) << k->name;
+        }
+    }
+
+    /* Clean */
+    EXPECT_FALSE(json_simd_use("mmx"));
+    EXPECT_TRUE(json_simd_use(active.c_str()));
+}
+
+TEST(JsonLexerTest, ExecuteLexerLongInput) {
+    /* Arrange */
+    std::string str = "[";
+    for (int i = 0; i < 100; i++) {
+        str += "\"padding \\\" [string] \\\\\",\n  ";
+    }
+    str += "{\"k\": 1}]";
+    struct json_lexer_context_t *lexer = json_create_lexer(str.c_str());
+
+    /* Act */
+    json_execute_lexer(lexer);
+
+    /* Assert */
+    ASSERT_EQ(1 + 100 * 2 + 5 + 1, lexer->tokens.length);
+    EXPECT_EQ(JLT_LARRAY, json_lexer_token_at(lexer, 0).type);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(JLT_STRING, json_lexer_token_at(lexer, 1 + i * 2).type) << "Case: " << i;
+        EXPECT_EQ(JLT_COMMA, json_lexer_token_at(lexer, 2 + i * 2).type) << "Case: " << i;
+        EXPECT_EQ((size_t)(1 + i), json_lexer_token_at(lexer, 1 + i * 2).row) << "Case: " << i;
+    }
+    EXPECT_EQ(JLT_LPAIR, json_lexer_token_at(lexer, 201).type);
+    EXPECT_EQ(JLT_NUMBER, json_lexer_token_at(lexer, 204).type);
+    EXPECT_EQ(JLT_RARRAY, json_lexer_token_at(lexer, 206).type);
+
+    /* Clean */
+    json_delete_lexer(lexer);
+}
+
+TEST(JsonLexerTest, TapeTokensMatchLexedTokens) {
+    /* Arrange */
+    const char *json_str = "{\"a\\\"b\": [1.5e3, -0, true, false, null, \"\"], \"caf\xc3\xa9\": {}}";
+    struct json_lexer_context_t *lexer = json_create_lexer(json_str);
+    struct json_lexer_context_t *scan = json_create_lexer(json_str);
+    struct json_lexer_token_t token;
+
+    /* Act */
+    json_execute_lexer(lexer);
+
+    /* Assert */
+    for (size_t i = 0; i < lexer->tokens.length; i++) {
+        ASSERT_TRUE(lex_next_token(scan, &token));
+        struct json_lexer_token_t t = json_lexer_token_at(lexer, i);
+        EXPECT_EQ(token.type, t.type) << i;
+        EXPECT_EQ(token.start, t.start) << i;
+        EXPECT_EQ(token.end, t.end) << i;
+        EXPECT_EQ(token.text, t.text) << i;
+        EXPECT_EQ(i, t.index);
+    }
+    EXPECT_FALSE(lex_next_token(scan, &token));
+
+    /* Clean */
+    json_delete_lexer(lexer);
+    json_delete_lexer(scan);
+}
+
+TEST(JsonLexerTest, TapeIsCompact) {
+    /* Arrange */
+    const char *json_str = "[\"ab\", 12]";
+    struct json_lexer_context_t *lexer = json_create_lexer(json_str);
+
+    /* Act */
+    json_execute_lexer(lexer);
+
+    /* Assert */
+    EXPECT_EQ(8, sizeof(json_tape_t));
+    ASSERT_EQ(5, lexer->tokens.length);
+    EXPECT_EQ(JSON_TAPE(JLT_LARRAY, 0), lexer->tokens.list[0]);
+    EXPECT_EQ(JSON_TAPE(JLT_STRING, 1), lexer->tokens.list[1]);
+    EXPECT_EQ(JSON_TAPE(JLT_COMMA, 5), lexer->tokens.list[2]);
+    EXPECT_EQ(JSON_TAPE(JLT_NUMBER, 7), lexer->tokens.list[3]);
+    EXPECT_EQ(JSON_TAPE(JLT_RARRAY, 9), lexer->tokens.list[4]);
+    EXPECT_EQ(JLT_NUMBER, JSON_TAPE_TYPE(lexer->tokens.list[3]));
+    EXPECT_EQ(7, JSON_TAPE_OFFSET(lexer->tokens.list[3]));
+    EXPECT_EQ(2u, lexer->tokens.lengths[1]);
+    EXPECT_EQ(2u, lexer->tokens.lengths[3]);
+    EXPECT_EQ(JLT_MISSING, json_lexer_token_at(lexer, 5).type);
+
+    /* Clean */
+    json_delete_lexer(lexer);
+}
@@ -9,6 +9,17 @@
 #include "test_object.cc"
 #include "test_lexer.cc"
 #include "test_parser.cc"
+#include "test_number.cc"
+#include "test_doc.cc"
+#include "test_error.cc"
+#include "test_validate.cc"
+#include "test_stream.cc"
+#include "test_ndjson.cc"
+#include "test_seq.cc"
+#include "test_index.cc"
+#include "test_pointer.cc"
+#include "test_sax.cc"
+#include "test_cursor.cc"
 
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
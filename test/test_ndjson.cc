@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "env.hh"
+
+static std::string dump_record(union json_t j) {
+    char *text = json_dumps(j, .indent = -1);
+    std::string s = text;
+    free(text);
+    return s;
+}
+
+static std::string make_lines(size_t n) {
+    std::string data;
+    for (size_t i = 0; i < n; i++)
+        data += "{\"id\": " + std::to_string(i) + ", \"tags\": [\"a\", \"b\"]}\n";
+    return data;
+}
+
+TEST(JsonNdjsonTest, RecordsKeepInputOrder) {
+    /* Arrange */
+    const std::string data = make_lines(1000);
+
+    for (size_t threads : {1, 2, 4, 8}) {
+        struct json_record_t *records = NULL;
+
+        /* Act */
+        size_t count = json_ndjson_parse(data.data(), data.size(), &records, .threads = threads, .batch_size = 100,
+                                         .typed_numbers = true);
+
+        /* Assert */
+        ASSERT_EQ(1000u, count) << threads;
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_EQ(JSON_ERROR_NONE, records[i].error.code);
+            ASSERT_EQ((int64_t)i, json_get(records[i].value, "id").tok.i64) << threads;
+        }
+
+        /* Clean */
+        json_ndjson_free(records, count);
+    }
+}
+
+TEST(JsonNdjsonTest, ValuesAreMallocedInsideDocument) {
+    /* Arrange */
+    const std::string data = make_lines(100);
+    struct json_doc_t *doc = json_doc_new();
+    struct json_record_t *records = NULL;
+
+    /* Act */
+    json_doc_begin(doc);
+    size_t count = json_ndjson_parse(data.data(), data.size(), &records, .threads = 1, .typed_numbers = true);
+    json_doc_end(doc);
+
+    /* Assert */
+    ASSERT_EQ(100u, count);
+    EXPECT_EQ(99, json_get(records[99].value, "id").tok.i64);
+    EXPECT_EQ(nullptr, doc->arena.chunks);
+
+    /* Clean */
+    json_ndjson_free(records, count);
+    json_doc_free(doc);
+}
+
+TEST(JsonNdjsonTest, ErrorPerRecord) {
+    /* Arrange */
+    const std::string data = "[1]\n{\"a\": }\n\n\"ok\"\n[1, 2\n";
+    struct json_record_t *records = NULL;
+
+    /* Act */
+    size_t count = json_ndjson_parse(data.data(), data.size(), &records, .threads = 2, .batch_size = 1);
+
+    /* Assert */
+    ASSERT_EQ(4u, count);
+    EXPECT_EQ("[1]", dump_record(records[0].value));
+    EXPECT_EQ(JT_MISSING, records[1].value.type);
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, records[1].error.code);
+    EXPECT_EQ(10u, records[1].error.offset);
+    EXPECT_EQ(2u, records[1].error.row);
+    EXPECT_EQ(7u, records[1].error.column);
+    EXPECT_EQ("\"ok\"", dump_record(records[2].value));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_EOF, records[3].error.code);
+    EXPECT_EQ(5u, records[3].error.row);
+
+    /* Clean */
+    json_ndjson_free(records, count);
+}
+
+TEST(JsonNdjsonTest, BlankLinesAndCrlf) {
+    /* Arrange */
+    const std::string data = "\r\n  1\r\n\t\n{}\r\n  \n[true]";
+    struct json_record_t *records = NULL;
+
+    /* Act */
+    size_t count = json_ndjson_parse(data.data(), data.size(), &records, .threads = 1);
+
+    /* Assert */
+    ASSERT_EQ(3u, count);
+    EXPECT_EQ("1", dump_record(records[0].value));
+    EXPECT_EQ("{}", dump_record(records[1].value));
+    EXPECT_EQ("[true]", dump_record(records[2].value));
+
+    /* Clean */
+    json_ndjson_free(records, count);
+}
+
+static void collect_record(size_t index, struct json_record_t *record, void *args) {
+    auto *ids = (std::vector<int64_t> *)args;
+    EXPECT_EQ(ids->size(), index);
+    ids->push_back(json_get(record->value, "id").tok.i64);
+    json_clean(&record->value);
+}
+
+TEST(JsonNdjsonTest, CallbackInInputOrder) {
+    /* Arrange */
+    const std::string data = make_lines(500);
+    std::vector<int64_t> ids;
+
+    /* Act */
+    size_t count = json_ndjson_parse(data.data(), data.size(), NULL, .threads = 4, .batch_size = 64,
+                                     .typed_numbers = true, .callback = collect_record, .args = &ids);
+
+    /* Assert */
+    ASSERT_EQ(500u, count);
+    ASSERT_EQ(500u, ids.size());
+    for (size_t i = 0; i < ids.size(); i++)
+        ASSERT_EQ((int64_t)i, ids[i]);
+}
+
+TEST(JsonNdjsonTest, ParseFile) {
+    /* Arrange */
+    const std::string data = make_lines(300);
+    char path[] = "/tmp/json_ndjson_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ((ssize_t)data.size(), write(fd, data.data(), data.size()));
+    close(fd);
+    struct json_record_t *records = NULL;
+
+    /* Act */
+    size_t count = json_ndjson_file(path, &records, .threads = 3, .batch_size = 256);
+
+    /* Assert */
+    ASSERT_EQ(300u, count);
+    EXPECT_EQ("{\"id\": 299, \"tags\": [\"a\", \"b\"]}", dump_record(records[299].value));
+
+    /* Clean */
+    json_ndjson_free(records, count);
+    unlink(path);
+}
+
+TEST(JsonNdjsonTest, ParseFileFromPipe) {
+    /* Arrange */
+    const std::string data = "1\n2\n3\n";
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_EQ((ssize_t)data.size(), write(fds[1], data.data(), data.size()));
+    close(fds[1]);
+    std::string path = "/dev/fd/" + std::to_string(fds[0]);
+    struct json_record_t *records = NULL;
+
+    /* Act */
+    size_t count = json_ndjson_file(path.c_str(), &records, .threads = 2);
+
+    /* Assert */
+    ASSERT_EQ(3u, count);
+    EXPECT_EQ("3", dump_record(records[2].value));
+
+    /* Clean */
+    json_ndjson_free(records, count);
+    close(fds[0]);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include "env.hh"
+
+static double parse_double(const char *text) {
+    double value = -1;
+    EXPECT_TRUE(json_parse_double(text, strlen(text), &value)) << text;
+    return value;
+}
+
+TEST(JsonNumberTest, ParseDouble) {
+    /* Clinger fast path */
+    EXPECT_EQ(0.0, parse_double("0"));
+    EXPECT_TRUE(signbit(parse_double("-0")));
+    EXPECT_EQ(1.5, parse_double("1.5"));
+    EXPECT_EQ(-122.4194155, parse_double("-122.4194155"));
+    EXPECT_EQ(1e22, parse_double("1e22"));
+    EXPECT_EQ(0.1, parse_double("1E-1"));
+
+    /* Eisel-Lemire */
+    EXPECT_EQ(1e23, parse_double("1e23"));
+    EXPECT_EQ(9007199254740992.0, parse_double("9007199254740993"));
+    EXPECT_EQ(1.7976931348623157e308, parse_double("1.7976931348623157e308"));
+    EXPECT_EQ(2.2250738585072014e-308, parse_double("2.2250738585072014e-308"));
+    EXPECT_EQ(4.9406564584124654e-324, parse_double("4.9406564584124654e-324"));
+    EXPECT_EQ(0.3, parse_double("0.299999999999999988897769753748434595763683319091796875"));
+
+    /* Out of range */
+    EXPECT_EQ(HUGE_VAL, parse_double("1e309"));
+    EXPECT_EQ(-HUGE_VAL, parse_double("-1e400"));
+    EXPECT_EQ(0.0, parse_double("1e-400"));
+    EXPECT_EQ(0.0, parse_double("0e99999999999"));
+}
+
+TEST(JsonNumberTest, ParseDoubleSlowPath) {
+    /* More than 19 digits, right at or just past the midpoint of two doubles */
+    EXPECT_EQ(9007199254740992.0, parse_double("9007199254740993.0000000000000000000000"));
+    EXPECT_EQ(9007199254740994.0, parse_double("9007199254740993.0000000000000000000001"));
+    EXPECT_EQ(1.0, parse_double("1.00000000000000011102230246251565404236316680908203125"));
+    EXPECT_EQ(1.0000000000000002, parse_double("1.00000000000000011102230246251565404236316680908203126"));
+    EXPECT_EQ(2.2250738585072011e-308,
+              parse_double("2.22507385850720113605740979670913197593481954635164564e-308"));
+}
+
+TEST(JsonNumberTest, ParseDoubleMatchesStrtod) {
+    char text[64];
+    uint64_t seed = 88172645463325252ULL;
+
+    for (int i = 0; i < 10000; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        double d;
+        memcpy(&d, &seed, sizeof(d));
+        if (!isfinite(d))
+            continue;
+
+        snprintf(text, sizeof(text), "%.*e", (int)(seed % 18), d);
+        EXPECT_EQ(strtod(text, NULL), parse_double(text)) << text;
+    }
+}
+
+TEST(JsonNumberTest, ParseDoubleRejectsInvalidText) {
+    const char *invalid[] = {"", "-", "+1", "01", "1.", ".5", "1e", "1e+", "0x10", "1.5f", "NaN", "Infinity", "1,5"};
+    double value;
+
+    for (const char *text : invalid) {
+        EXPECT_FALSE(json_parse_double(text, strlen(text), &value)) << text;
+    }
+
+    /* only len bytes are read */
+    EXPECT_TRUE(json_parse_double("1.25]", 4, &value));
+    EXPECT_EQ(1.25, value);
+}
+
+TEST(JsonNumberTest, DecodeNumber) {
+    /* Arrange */
+    union json_t j = json_deserialize("[1, 2.5, -3e2, 18446744073709551616, \"4\"]");
+
+    /* Act & Assert */
+    EXPECT_TRUE(json_decode_number(json_getp(j, 0)));
+    EXPECT_EQ(JT_INT, json_get(j, 0).type);
+    EXPECT_EQ(1, json_get(j, 0).i64);
+    EXPECT_TRUE(json_decode_number(json_getp(j, 1)));
+    EXPECT_EQ(JT_FLOAT, json_get(j, 1).type);
+    EXPECT_EQ(2.5, json_get(j, 1).f);
+    EXPECT_TRUE(json_decode_number(json_getp(j, 2)));
+    EXPECT_EQ(-300.0, json_get(j, 2).f);
+    EXPECT_FALSE(json_decode_number(json_getp(j, 3)));
+    EXPECT_EQ(JT_NUMBER, json_get(j, 3).type);
+    EXPECT_FALSE(json_decode_number(json_getp(j, 4)));
+    EXPECT_EQ(JT_STRING, json_get(j, 4).type);
+
+    /* Clean */
+    json_clean(&j);
+}
@@ -835,3 +835,31 @@ TEST(JsonObjectTest, SetEmptyToDelete) {
     /* Clean */
     json_clean(&j);
 }
+
+TEST(JsonObjectTest, ReserveAndEmplace) {
+    /* Arrange */
+    union json_t j = JSON_OBJECT;
+    struct json_pair_t *a = (struct json_pair_t *)json_malloc(sizeof(struct json_pair_t));
+    struct json_pair_t *b = (struct json_pair_t *)json_malloc(sizeof(struct json_pair_t));
+    *a = (struct json_pair_t){.key = json_strdup("A"), .value = JSON_INT(1)};
+    *b = (struct json_pair_t){.key = json_strdup("A"), .value = JSON_INT(2)};
+
+    /* Act */
+    bool ok = jsonext_obj_reserve(&j, 100);
+    size_t reserved = json_capacity(j);
+    struct json_pair_t *first = jsonext_obj_emplace(&j, a);
+    struct json_pair_t *second = jsonext_obj_emplace(&j, b);
+
+    /* Assert */
+    EXPECT_TRUE(ok);
+    EXPECT_LE(200u, reserved);
+    EXPECT_EQ(a, first);
+    EXPECT_EQ(a, second);
+    EXPECT_EQ(1, json_length(j));
+    EXPECT_EQ(1, json_get(j, "A").i64);
+
+    /* Clean */
+    json_free(b->key);
+    json_free(b);
+    json_clean(&j);
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <string>
+
+#include <unistd.h>
+
 #include "env.hh"
 #include "json.h"
 
@@ -104,6 +108,62 @@ TEST(JsonParserTest, FilePointerIsNull) {
     json_clean(&j);
 }
 
+TEST(JsonParserTest, LoadJsonFileFromPipe) {
+    /* Arrange */
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    const char *data = "[\"not\", \"a\", \"regular\", \"file\"]";
+    ASSERT_EQ((ssize_t)strlen(data), write(fds[1], data, strlen(data)));
+    close(fds[1]);
+    std::string path = "/dev/fd/" + std::to_string(fds[0]);
+
+    /* Act */
+    union json_t j = json_file(path.c_str());
+
+    /* Assert */
+    EXPECT_EQ(JT_ARRAY, j.type);
+    EXPECT_EQ(4, json_length(j));
+    EXPECT_STREQ("file", json_get(j, 3).text);
+
+    /* Clean */
+    close(fds[0]);
+    json_clean(&j);
+}
+
+TEST(JsonParserTest, LoadJsonFileEndsAtPage) {
+    /* Arrange: the number ends with a full page, the mapping has no terminator after it */
+    const char *filename = "/tmp/test_page.json";
+    std::string text = std::string(4096 - 5, ' ') + "12345";
+
+    FILE *fp = fopen(filename, "w");
+    ASSERT_TRUE(fp != nullptr);
+    ASSERT_EQ(text.size(), fwrite(text.data(), 1, text.size(), fp));
+    fclose(fp);
+
+    /* Act */
+    union json_t j = json_file(filename);
+
+    /* Assert */
+    EXPECT_EQ(JT_NUMBER, j.type);
+    EXPECT_STREQ("12345", j.text);
+
+    /* Clean */
+    json_clean(&j);
+    ASSERT_EQ(0, remove(filename));
+}
+
+TEST(JsonParserTest, LoadEmptyFile) {
+    const char *filename = "/tmp/test_empty.json";
+    FILE *fp = fopen(filename, "w");
+    ASSERT_TRUE(fp != nullptr);
+    fclose(fp);
+
+    union json_t j = json_file(filename);
+    EXPECT_EQ(JT_MISSING, j.type);
+
+    ASSERT_EQ(0, remove(filename));
+}
+
 TEST(JsonParserTest, ParseNestedArray) {
     /* Arrange */
     const char *data = "[ true, false, null, [ \"1\", \"2\" ], [ ], { } ]";
@@ -157,3 +217,460 @@ TEST(JsonParserTest, ParseNestedObject) {
     json_clean(&j);
 }
 
+
+TEST(JsonParserTest, ParseOnDemand) {
+    /* Arrange */
+    const char *data = "{ \"A\" : [ 1, \"2\", { \"B\" : null } ], \"C\" : true }";
+    struct json_lexer_context_t *lexer = json_create_lexer(data);
+    struct json_parser_context_t *parser = json_create_parser(lexer);
+    parser->on_demand = true;
+
+    /* Act */
+    json_parse(parser);
+    union json_t j = parser->root;
+
+    /* Assert */
+    EXPECT_EQ(NULL, lexer->tokens.list);
+    EXPECT_EQ(0, lexer->tokens.length);
+    EXPECT_EQ(JT_OBJECT, j.type);
+    EXPECT_EQ(2, json_length(j));
+    EXPECT_EQ(3, json_length(json_get(j, "A")));
+    EXPECT_STREQ("1", json_get(json_get(j, "A"), 0).text);
+    EXPECT_STREQ("2", json_get(json_get(j, "A"), 1).text);
+    EXPECT_EQ(JT_NULL, json_get(json_get(json_get(j, "A"), 2), "B").type);
+    EXPECT_TRUE(json_get(j, "C").boolean);
+
+    /* Clean */
+    json_clean(&j);
+    json_delete_lexer(lexer);
+    json_delete_parser(parser);
+}
+
+TEST(JsonParserTest, ParseTwoPhase) {
+    /* Arrange */
+    const char *data = "[ \"A\", [ ], { \"B\" : false } ]";
+    struct json_lexer_context_t *lexer = json_create_lexer(data);
+    struct json_parser_context_t *parser = json_create_parser(lexer);
+
+    /* Act */
+    json_execute_lexer(lexer);
+    json_parse(parser);
+    union json_t j = parser->root;
+
+    /* Assert */
+    EXPECT_EQ(12, lexer->tokens.length);
+    EXPECT_EQ(12, parser->token_index);
+    EXPECT_EQ(JT_ARRAY, j.type);
+    EXPECT_EQ(3, json_length(j));
+    EXPECT_STREQ("A", json_get(j, 0).text);
+    EXPECT_EQ(0, json_length(json_get(j, 1)));
+    EXPECT_FALSE(json_get(json_get(j, 2), "B").boolean);
+
+    /* Clean */
+    json_clean(&j);
+    json_delete_lexer(lexer);
+    json_delete_parser(parser);
+}
+
+TEST(JsonParserTest, ParseTypedNumbers) {
+    /* Arrange */
+    const char *data = "[ 0, -1, 1234567890123456789, 9223372036854775807, 9223372036854775808, 18446744073709551615, "
+                       "18446744073709551616, -9223372036854775808, -9223372036854775809, 1.5, -2.5e3, 1E-2, 1e400 ]";
+
+    /* Act */
+    union json_t j = json_deserialize_with(data, .typed_numbers = true);
+
+    /* Assert */
+    ASSERT_EQ(JT_ARRAY, j.type);
+    ASSERT_EQ(13, json_length(j));
+    EXPECT_EQ(JT_INT, json_get(j, 0).type);
+    EXPECT_EQ(0, json_get(j, 0).i64);
+    EXPECT_EQ(JT_INT, json_get(j, 1).type);
+    EXPECT_EQ(-1, json_get(j, 1).i64);
+    EXPECT_EQ(JT_INT, json_get(j, 2).type);
+    EXPECT_EQ(1234567890123456789LL, json_get(j, 2).i64);
+    EXPECT_EQ(JT_INT, json_get(j, 3).type);
+    EXPECT_EQ(INT64_MAX, json_get(j, 3).i64);
+    EXPECT_EQ(JT_UINT, json_get(j, 4).type);
+    EXPECT_EQ(9223372036854775808ULL, json_get(j, 4).u64);
+    EXPECT_EQ(JT_UINT, json_get(j, 5).type);
+    EXPECT_EQ(UINT64_MAX, json_get(j, 5).u64);
+    EXPECT_EQ(JT_NUMBER, json_get(j, 6).type);
+    EXPECT_STREQ("18446744073709551616", json_get(j, 6).text);
+    EXPECT_EQ(JT_INT, json_get(j, 7).type);
+    EXPECT_EQ(INT64_MIN, json_get(j, 7).i64);
+    EXPECT_EQ(JT_NUMBER, json_get(j, 8).type);
+    EXPECT_EQ(JT_FLOAT, json_get(j, 9).type);
+    EXPECT_DOUBLE_EQ(1.5, json_get(j, 9).f);
+    EXPECT_EQ(JT_FLOAT, json_get(j, 10).type);
+    EXPECT_DOUBLE_EQ(-2500.0, json_get(j, 10).f);
+    EXPECT_EQ(JT_FLOAT, json_get(j, 11).type);
+    EXPECT_DOUBLE_EQ(0.01, json_get(j, 11).f);
+    EXPECT_EQ(JT_NUMBER, json_get(j, 12).type);
+    EXPECT_STREQ("1e400", json_get(j, 12).text);
+
+    /* Clean */
+    json_clean(&j);
+}
+
+TEST(JsonParserTest, ParseEightDigits) {
+    /* Arrange */
+    const char *digits = "0123456789012345";
+
+    /* Act & Assert */
+    EXPECT_TRUE(is_eight_digits(digits));
+    EXPECT_FALSE(is_eight_digits("1234567a"));
+    EXPECT_FALSE(is_eight_digits("1234/678"));
+    EXPECT_FALSE(is_eight_digits("12345:78"));
+    EXPECT_EQ(1234567u, parse_eight_digits(digits));
+    EXPECT_EQ(89012345u, parse_eight_digits(digits + 8));
+    EXPECT_EQ(99999999u, parse_eight_digits("99999999"));
+}
+
+TEST(JsonParserTest, ParseDuplicateKey) {
+    /* Arrange */
+    const char *data = "{\"a\": 1, \"ab\": 2, \"a\": 3}";
+
+    /* Act */
+    union json_t j = json_deserialize_with(data, .typed_numbers = true);
+
+    /* Assert */
+    EXPECT_EQ(2, json_length(j));
+    EXPECT_EQ(3, json_get(j, "a").i64);
+    EXPECT_EQ(2, json_get(j, "ab").i64);
+
+    /* Clean */
+    json_clean(&j);
+}
+
+TEST(JsonParserTest, ParseEscapedStrings) {
+    /* Arrange */
+    const char *data = "{\"k\\ney\": [\"plain\", \"a\\\"b\\\\c\\/d\", \"\\b\\f\\n\\r\\t\", \"caf\\u00e9 \\u20AC \\ud83d\\ude00\"]}";
+
+    /* Act */
+    union json_t j = json_deserialize(data);
+
+    /* Assert */
+    union json_t arr = json_get(j, "k\ney");
+    ASSERT_EQ(JT_ARRAY, arr.type);
+    EXPECT_STREQ("plain", json_get(arr, 0).text);
+    EXPECT_STREQ("a\"b\\c/d", json_get(arr, 1).text);
+    EXPECT_STREQ("\b\f\n\r\t", json_get(arr, 2).text);
+    EXPECT_STREQ("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80", json_get(arr, 3).text);
+
+    /* Clean */
+    json_clean(&j);
+}
+
+TEST(JsonParserTest, ParseDumpRoundTrip) {
+    /* Arrange */
+    const char *data = "{\"a\\\"b\": [\"x\\ny\", \"\\u0001\\\\\"]}";
+    union json_t j = json_deserialize(data);
+
+    /* Act */
+    char *text = json_dumps(j, .indent = -1);
+    union json_t k = json_deserialize(text);
+
+    /* Assert */
+    EXPECT_STREQ("{\"a\\\"b\": [\"x\\ny\", \"\\u0001\\\\\"]}", text);
+    EXPECT_STREQ("x\ny", json_get(json_get(k, "a\"b"), 0).text);
+    EXPECT_STREQ("\x01\\", json_get(json_get(k, "a\"b"), 1).text);
+
+    /* Clean */
+    free(text);
+    json_clean(&j);
+    json_clean(&k);
+}
+
+TEST(JsonParserTest, DumpLongString) {
+    std::string data = "[\"" + std::string(1000, 'x') + "\\n" + std::string(1000, 'y') + "\"]";
+    union json_t j = json_deserialize(data.c_str());
+
+    char *text = json_dumps(j, .indent = -1);
+    EXPECT_EQ(data, text);
+
+    free(text);
+    json_clean(&j);
+}
+
+TEST(JsonParserTest, UnescapeString) {
+    const char *invalid[] = {"\\", "\\x", "\\u12", "\\u12g4", "\\ud83d", "\\ud83d\\u0041", "\\ude00"};
+    char out[16];
+
+    for (const char *text : invalid) {
+        EXPECT_EQ(SIZE_MAX, unescape_string(out, text, strlen(text))) << text;
+    }
+
+    EXPECT_EQ(2u, unescape_string(out, "\\u00e9", 6));
+    EXPECT_EQ(0, memcmp("\xc3\xa9", out, 2));
+}
+
+TEST(JsonParserTest, LongStringsWithEscapesAtVectorEdges) {
+    const char *kernels[] = {"scalar", "sse4.2", "avx2", "avx512"};
+    std::string active = json_simd_kernel_name();
+
+    for (const char *kernel : kernels) {
+        if (!json_simd_use(kernel))
+            continue;
+
+        for (size_t at : {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 200}) {
+            std::string plain(at, 'x'), text = "[\"" + plain + "\\n" + plain + "\\u00e9\"]";
+            std::string expect = plain + "\n" + plain + "\xc3\xa9";
+            struct json_error_t error;
+
+            /* Act */
+            union json_t j = json_deserialize_with(text.c_str(), .error = &error);
+
+            /* Assert */
+            ASSERT_EQ(JSON_ERROR_NONE, error.code) << kernel << " " << at;
+            EXPECT_EQ(expect, json_get(j, 0).text) << kernel << " " << at;
+            json_clean(&j);
+
+            // a raw control byte or a missing quote right at the edge
+            text = "[\"" + plain + "\x01\"]";
+            json_deserialize_with(text.c_str(), .error = &error);
+            EXPECT_EQ(JSON_ERROR_INVALID_STRING, error.code) << kernel << " " << at;
+            EXPECT_EQ(2 + at, error.offset) << kernel << " " << at;
+            text = "[\"" + plain + "\\";
+            json_deserialize_with(text.c_str(), .error = &error);
+            EXPECT_EQ(JSON_ERROR_INVALID_STRING, error.code) << kernel << " " << at;
+        }
+    }
+
+    EXPECT_TRUE(json_simd_use(active.c_str()));
+}
+
+static union json_t parse_text(const char *text, void (*parse)(struct json_parser_context_t *), size_t max_depth = 0) {
+    struct json_lexer_context_t *lexer = json_create_lexer(text);
+    struct json_parser_context_t *parser = json_create_parser(lexer);
+
+    parser->on_demand = true;
+    parser->config.max_depth = max_depth;
+    parse(parser);
+
+    union json_t j = parser->root;
+    json_delete_lexer(lexer);
+    json_delete_parser(parser);
+    return j;
+}
+
+TEST(JsonParserTest, ParseIterativeMatchesRecursive) {
+    const char *data[] = {
+        "1", "\"s\"", "[]", "{}", "[[], {}, [[]]]", "{\"a\": {}, \"b\": []}",
+        "{\"a\": [1, {\"b\": [true, false, null]}, \"x\"], \"c\": {\"d\": {\"e\": 2.5}}}",
+        "[{\"k\": [[1, 2], [3]]}, [{}, {\"z\": null}], -7]",
+    };
+
+    for (const char *text : data) {
+        union json_t j = parse_text(text, json_parse);
+        union json_t k = parse_text(text, json_parse_recursive);
+        char *a = json_dumps(j, .indent = -1);
+        char *b = json_dumps(k, .indent = -1);
+
+        EXPECT_STREQ(b, a) << text;
+
+        free(a);
+        free(b);
+        json_clean(&j);
+        json_clean(&k);
+    }
+}
+
+TEST(JsonParserTest, ParseWideObject) {
+    std::string wide = "{", repeated = "{";
+    for (int i = 0; i < 1000; i++)
+        wide += (i ? ",\"k" : "\"k") + std::to_string(i) + "\": {\"v\": " + std::to_string(i) + "}";
+    wide += "}";
+    // every tenth key of the wide object once more, with a new value
+    repeated += wide.substr(1, wide.size() - 2);
+    for (int i = 0; i < 1000; i += 10)
+        repeated += ",\"k" + std::to_string(i) + "\": {\"v\": " + std::to_string(1000 + i) + "}";
+    repeated += "}";
+
+    for (auto parse : {json_parse, json_parse_recursive}) {
+        union json_t j = parse_text(wide.c_str(), parse);
+        union json_t k = parse_text(repeated.c_str(), parse);
+
+        ASSERT_EQ(JT_OBJECT, j.type);
+        EXPECT_EQ(1000, json_length(j));
+        // sized once for the final count, growing from the minimum would end at 2048
+        EXPECT_LT(json_capacity(j), 2048u);
+        EXPECT_STREQ("999", json_get(json_get(j, "k999"), "v").text);
+
+        ASSERT_EQ(JT_OBJECT, k.type);
+        EXPECT_EQ(1000, json_length(k));
+        EXPECT_STREQ("1", json_get(json_get(k, "k1"), "v").text);
+        EXPECT_STREQ("1010", json_get(json_get(k, "k10"), "v").text);
+        EXPECT_STREQ("1990", json_get(json_get(k, "k990"), "v").text);
+
+        json_clean(&j);
+        json_clean(&k);
+    }
+}
+
+TEST(JsonParserTest, ParseObjectErrorReleasesMembers) {
+    const char *data[] = {
+        "{\"a\": {\"b\": 1, \"c\": [1, {\"d\": 2}]}, \"e\": {\"f\": ",
+        "{\"a\": 1, \"b\": {\"c\": 2,}}",
+        "[{\"a\": 1}, {\"b\": {\"c\": \"x\"} \"d\"}]",
+    };
+
+    for (const char *text : data) {
+        EXPECT_EQ(JT_MISSING, parse_text(text, json_parse).type) << text;
+        EXPECT_EQ(JT_MISSING, parse_text(text, json_parse_recursive).type) << text;
+    }
+}
+
+TEST(JsonParserTest, ParseMaxDepth) {
+    const char *data = "[{\"a\": [1]}]";
+
+    union json_t j = parse_text(data, json_parse, 3);
+    EXPECT_STREQ("1", json_get(json_get(json_get(j, 0), "a"), 0).text);
+    json_clean(&j);
+
+    j = parse_text(data, json_parse, 2);
+    EXPECT_EQ(JT_MISSING, j.type);
+
+    j = json_deserialize_with("[[1]]", .max_depth = 1);
+    EXPECT_EQ(JT_MISSING, j.type);
+}
+
+TEST(JsonParserTest, ParseDeepNesting) {
+    const size_t depth = 20000;
+    std::string text = std::string(depth, '[') + std::string(depth, ']');
+
+    union json_t j = json_deserialize(text.c_str());
+    EXPECT_EQ(JT_MISSING, j.type);
+
+    j = json_deserialize_with(text.c_str(), .max_depth = depth);
+    union json_t cur = j;
+    size_t levels = 0;
+    while (cur.type == JT_ARRAY && json_length(cur) > 0) {
+        cur = json_get(cur, 0);
+        levels++;
+    }
+    EXPECT_EQ(depth - 1, levels);
+    json_clean(&j);
+}
+
+/* A root with `n` members whose strings hold quotes, brackets, commas and backslash runs. */
+static std::string make_tricky(size_t n, bool object) {
+    std::string text = object ? "{" : "[";
+    for (size_t i = 0; i < n; i++) {
+        if (i)
+            text += i % 3 ? "," : " ,\n ";
+        if (object)
+            text += "\"k" + std::to_string(i % (n - 3)) + "\": ";
+        text += "{\"id\": " + std::to_string(i) + ", \"s\": \"a\\\"b,]}" + std::string(i % 7, 'x') +
+                "\", \"bs\": \"" + std::string(2 * (i % 5), '\\') + "\", \"arr\": [1, [2, {\"x\": \"[\"}]], \"n\": null}";
+    }
+    return text + (object ? "}" : "]");
+}
+
+static void expect_same_tree(union json_t expected, union json_t actual) {
+    ASSERT_EQ(expected.type, actual.type);
+    ASSERT_EQ(json_length(expected), json_length(actual));
+    if (expected.type == JT_OBJECT) {
+        json_foreach_obj(expected, it) {
+            char *a = json_dumps(it->value, .indent = -1);
+            char *b = json_dumps(json_get(actual, it->key), .indent = -1);
+            EXPECT_STREQ(a, b) << it->key;
+            free(a);
+            free(b);
+        }
+        return;
+    }
+    char *a = json_dumps(expected, .indent = -1);
+    char *b = json_dumps(actual, .indent = -1);
+    EXPECT_STREQ(a, b);
+    free(a);
+    free(b);
+}
+
+TEST(JsonParserTest, ParseParallelMatchesSequential) {
+    for (bool object : {false, true}) {
+        std::string text = make_tricky(200, object);
+        union json_t expected = json_deserialize_with(text.c_str(), .typed_numbers = true);
+        ASSERT_NE(JT_MISSING, expected.type);
+
+        for (size_t chunk : {64, 128, 320, 4096}) {
+            for (size_t threads : {2, 4}) {
+                union json_t j;
+                struct json_parse_config config = {.typed_numbers = true, .threads = threads};
+
+                ASSERT_TRUE(parse_parallel(text.data(), text.size(), config, chunk, &j)) << chunk;
+                expect_same_tree(expected, j);
+                json_clean(&j);
+            }
+        }
+        json_clean(&expected);
+    }
+}
+
+TEST(JsonParserTest, ParseParallelFallsBack) {
+    std::string body = make_tricky(50, false);
+    body = body.substr(1, body.size() - 2);
+    const std::string data[] = {
+        "[" + body + ",]",
+        "[" + body + ",," + body + "]",
+        "[" + body + "],[" + body + "]",
+        "[" + body + ", \"open]",
+        "[" + body + "] x",
+        "[" + body + ", tru]",
+        "{" + body + "}",
+        "[" + body + "}",
+        "[1]",
+        "\"" + body + "\"",
+    };
+
+    for (const std::string &text : data) {
+        union json_t j;
+        struct json_parse_config config = {.threads = 4};
+        EXPECT_FALSE(parse_parallel(text.data(), text.size(), config, 64, &j)) << text.substr(text.size() - 20);
+    }
+
+    // the root counts as one level
+    std::string text = "[" + body + "]";
+    union json_t j;
+    struct json_parse_config config = {.max_depth = 4, .threads = 4};
+    EXPECT_FALSE(parse_parallel(text.data(), text.size(), config, 64, &j));
+    config.max_depth = 5;
+    ASSERT_TRUE(parse_parallel(text.data(), text.size(), config, 64, &j));
+    json_clean(&j);
+}
+
+TEST(JsonParserTest, DeserializeWithThreads) {
+    std::string text = make_tricky(20000, false);
+    ASSERT_GE(text.size(), (size_t)JSON_PARALLEL_MIN);
+    struct json_error_t error;
+
+    union json_t expected = json_deserialize(text.c_str());
+    union json_t j = json_deserialize_n_with(text.data(), text.size(), .error = &error, .threads = 4);
+    EXPECT_EQ(JSON_ERROR_NONE, error.code);
+    expect_same_tree(expected, j);
+    json_clean(&j);
+    json_clean(&expected);
+
+    // errors are reported as by a sequential parse
+    size_t bad = text.find("null}", text.size() / 2) + 4;
+    text.insert(bad, "]");
+    j = json_deserialize_n_with(text.data(), text.size(), .error = &error, .threads = 4);
+    EXPECT_EQ(JT_MISSING, j.type);
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, error.code);
+    EXPECT_EQ(bad, error.offset);
+}
+
+TEST(JsonParserTest, DeserializeWithThreadsInsideDocument) {
+    std::string text = make_tricky(20000, false);
+    struct json_doc_t *doc = json_doc_new();
+    union json_t expected = json_deserialize(text.c_str());
+
+    // workers have no document, so the whole tree must come from the calling thread
+    json_doc_begin(doc);
+    union json_t j = json_deserialize_n_with(text.data(), text.size(), .threads = 4);
+    json_doc_end(doc);
+
+    expect_same_tree(expected, j);
+    json_clean(&expected);
+    json_doc_free(doc);
+}
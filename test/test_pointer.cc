@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "env.hh"
+
+static std::string paths_dump(const std::string &data, std::initializer_list<const char *> paths,
+                              struct json_error_t *error = NULL) {
+    std::vector<const char *> list(paths);
+    union json_t j = json_deserialize_paths(data.data(), data.size(), list.data(), list.size(), .error = error);
+
+    if (j.type == JT_MISSING)
+        return "<missing>";
+
+    char *text = json_dumps(j, .indent = -1);
+    std::string out = text;
+    free(text);
+    json_clean(&j);
+    return out;
+}
+
+TEST(JsonPointerTest, SelectsOnlyRequestedMembers) {
+    /* Arrange */
+    const std::string data = "{\"id\": 7, \"user\": {\"name\": \"ann\", \"tags\": [1, 2, {\"x\": []}], \"age\": 30},"
+                             " \"blob\": [[[\"}\"]], {\"k\": \"]\\\"\"}], \"ok\": true}";
+
+    /* Act & Assert */
+    EXPECT_EQ("{\"id\": 7}", paths_dump(data, {"/id"}));
+    EXPECT_EQ("{\"user\": {\"name\": \"ann\"}}", paths_dump(data, {"/user/name"}));
+    EXPECT_EQ("{\"user\": {\"tags\": [1, 2, {\"x\": []}]}, \"ok\": true}", paths_dump(data, {"/user/tags", "/ok"}));
+    EXPECT_EQ("{}", paths_dump(data, {"/nope", "/id/deeper"}));
+    EXPECT_EQ("{\"blob\": [[[\"}\"]]]}", paths_dump(data, {"/blob/0"}));
+}
+
+TEST(JsonPointerTest, WholeDocument) {
+    /* Arrange */
+    const std::string data = "[1, {\"a\": null}]";
+
+    /* Act & Assert */
+    EXPECT_EQ("[1, {\"a\": null}]", paths_dump(data, {"", "/0"}));
+    EXPECT_EQ("<missing>", paths_dump("42", {"/a"}));
+    EXPECT_EQ("42", paths_dump("42", {""}));
+}
+
+TEST(JsonPointerTest, ArrayIndexesKeepTheirPlace) {
+    /* Arrange */
+    const std::string data = "[{\"a\": 1}, [2], \"three\", {\"a\": 4, \"b\": 5}, 6]";
+
+    /* Act & Assert */
+    EXPECT_EQ("[null, null, null, {\"a\": 4}]", paths_dump(data, {"/3/a"}));
+    EXPECT_EQ("[{\"a\": 1}, null, \"three\"]", paths_dump(data, {"/2", "/0"}));
+    EXPECT_EQ("[]", paths_dump(data, {"/-", "/01", "/x"}));
+    EXPECT_EQ("[null, null, null, null, 6]", paths_dump(data, {"/4"}));
+}
+
+TEST(JsonPointerTest, EscapedReferenceTokens) {
+    /* Arrange */
+    const std::string data = "{\"a/b\": 1, \"m~n\": 2, \"\": 3, \"\\u0063\": 4, \"~1\": 5}";
+
+    /* Act & Assert */
+    EXPECT_EQ("{\"a/b\": 1}", paths_dump(data, {"/a~1b"}));
+    EXPECT_EQ("{\"m~n\": 2}", paths_dump(data, {"/m~0n"}));
+    EXPECT_EQ("{\"\": 3}", paths_dump(data, {"/"}));
+    EXPECT_EQ("{\"c\": 4}", paths_dump(data, {"/c"}));
+    EXPECT_EQ("{\"~1\": 5}", paths_dump(data, {"/~01"}));
+    EXPECT_EQ("{}", paths_dump(data, {"a~1b"}));
+}
+
+TEST(JsonPointerTest, LastRepeatedKeyWins) {
+    EXPECT_EQ("{\"a\": 2}", paths_dump("{\"a\": 1, \"b\": {}, \"a\": 2}", {"/a"}));
+}
+
+TEST(JsonPointerTest, SyntaxErrors) {
+    struct json_error_t error;
+
+    // selected values and the structure around them are checked
+    EXPECT_EQ("<missing>", paths_dump("{\"a\": [1, 2}", {"/a"}, &error));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, error.code);
+    EXPECT_EQ("<missing>", paths_dump("{\"a\": 1 \"b\": 2}", {"/a"}, &error));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, error.code);
+    EXPECT_EQ("<missing>", paths_dump("{\"a\": 1} {}", {"/a"}, &error));
+    EXPECT_EQ(JSON_ERROR_TRAILING_DATA, error.code);
+    EXPECT_EQ("<missing>", paths_dump("{\"a\": 1, \"b\": [[{}]", {"/a"}, &error));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_EOF, error.code);
+    EXPECT_EQ(1u, error.row);
+
+    // skipped subtrees only need as many closing brackets as opening ones
+    EXPECT_EQ("{\"a\": 1}", paths_dump("{\"b\": [1 2 : {]], \"a\": 1}", {"/a"}, &error));
+    EXPECT_EQ(JSON_ERROR_NONE, error.code);
+}
+
+TEST(JsonPointerTest, MatchesFullParse) {
+    /* Arrange */
+    std::string data = "{\"skip\": [";
+    for (int i = 0; i < 2000; i++)
+        data += "{\"s\": \"a\\\\\\\"[{\", \"n\": [" + std::to_string(i) + ", 1e3, -0.5]},\n";
+    data += "{}], \"keep\": {\"v\": [\"x\\ny\", {\"deep\": [[[true]]]}]}}";
+
+    union json_t full = json_deserialize(data.c_str());
+    union json_t keep = json_get(full, "keep");
+    char *expected = json_dumps(keep, .indent = -1);
+
+    /* Act & Assert */
+    EXPECT_EQ(std::string("{\"keep\": ") + expected + "}", paths_dump(data, {"/keep"}));
+    EXPECT_EQ("{\"skip\": [null, {\"n\": [1, 1e3, -0.5]}]}", paths_dump(data, {"/skip/1/n"}));
+
+    /* Clean */
+    free(expected);
+    json_clean(&full);
+}
+
+TEST(JsonPointerTest, IntoDocument) {
+    /* Arrange */
+    const char *paths[] = {"/b"};
+    struct json_doc_t *doc = json_doc_new();
+
+    /* Act */
+    doc->root = json_deserialize_paths("{\"a\": 1, \"b\": \"two\"}", 20, paths, 1, .doc = doc);
+
+    /* Assert */
+    EXPECT_STREQ("two", json_get(doc->root, "b").tok.text);
+    EXPECT_EQ(1u, json_length(doc->root));
+
+    /* Clean */
+    json_doc_free(doc);
+}
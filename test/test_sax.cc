@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "env.hh"
+
+/* Records every event as a short tag, stops after `limit` events. */
+struct sax_trace_t {
+    std::string events;
+    size_t count = 0;
+    size_t limit = SIZE_MAX;
+};
+
+static bool sax_event(sax_trace_t *t, const std::string &event) {
+    t->events += (t->events.empty() ? "" : " ") + event;
+    return ++t->count < t->limit;
+}
+
+static struct json_sax_config sax_tracer(sax_trace_t *t) {
+    struct json_sax_config config = {
+        .start_object = [](void *a) { return sax_event((sax_trace_t *)a, "{"); },
+        .end_object = [](void *a) { return sax_event((sax_trace_t *)a, "}"); },
+        .start_array = [](void *a) { return sax_event((sax_trace_t *)a, "["); },
+        .end_array = [](void *a) { return sax_event((sax_trace_t *)a, "]"); },
+        .key = [](const char *s, size_t n, void *a) { return sax_event((sax_trace_t *)a, "k:" + std::string(s, n)); },
+        .string = [](const char *s, size_t n, void *a) { return sax_event((sax_trace_t *)a, "s:" + std::string(s, n)); },
+        .number = [](const char *s, size_t n, void *a) { return sax_event((sax_trace_t *)a, "n:" + std::string(s, n)); },
+        .boolean = [](bool b, void *a) { return sax_event((sax_trace_t *)a, b ? "true" : "false"); },
+        .null = [](void *a) { return sax_event((sax_trace_t *)a, "null"); },
+        .args = t,
+        .max_depth = 0,
+    };
+    return config;
+}
+
+TEST(JsonSaxTest, EventsInDocumentOrder) {
+    /* Arrange */
+    const std::string data = "{\"a\": [1, -2.5e3, \"x\\ty\"], \"b\": {}, \"c\\u0041\": [true, false, null, []]}";
+    sax_trace_t trace;
+
+    /* Act */
+    struct json_error_t error = __json_sax_parse(data.data(), data.size(), sax_tracer(&trace));
+
+    /* Assert */
+    EXPECT_EQ(JSON_ERROR_NONE, error.code);
+    EXPECT_EQ("{ k:a [ n:1 n:-2.5e3 s:x\ty ] k:b { } k:cA [ true false null [ ] ] }", trace.events);
+}
+
+TEST(JsonSaxTest, ScalarRoot) {
+    sax_trace_t trace;
+
+    EXPECT_EQ(JSON_ERROR_NONE, __json_sax_parse(" \"s\" ", 5, sax_tracer(&trace)).code);
+    EXPECT_EQ("s:s", trace.events);
+}
+
+TEST(JsonSaxTest, NullCallbacksAreSkipped) {
+    /* Arrange */
+    const std::string data = "[{\"v\": 1}, {\"v\": 2}, {\"w\": 9}, {\"v\": 3.5}]";
+    double sum = 0;
+
+    /* Act */
+    struct json_error_t error = json_sax_parse(data.data(), data.size(), .number = [](const char *s, size_t n, void *a) {
+        double d;
+        json_parse_double(s, n, &d);
+        *(double *)a += d;
+        return true;
+    }, .args = &sum);
+
+    /* Assert */
+    EXPECT_EQ(JSON_ERROR_NONE, error.code);
+    EXPECT_DOUBLE_EQ(15.5, sum);
+}
+
+TEST(JsonSaxTest, CallbackAborts) {
+    /* Arrange */
+    const std::string data = "[1, [2, 3], 4]";
+    sax_trace_t trace;
+    trace.limit = 3;
+
+    /* Act */
+    struct json_error_t error = __json_sax_parse(data.data(), data.size(), sax_tracer(&trace));
+
+    /* Assert */
+    EXPECT_EQ(JSON_ERROR_ABORTED, error.code);
+    EXPECT_EQ(4u, error.offset);
+    EXPECT_EQ("[ n:1 [", trace.events);
+}
+
+TEST(JsonSaxTest, SyntaxErrors) {
+    struct json_error_t error;
+    sax_trace_t trace;
+
+    // events before the error have been delivered
+    error = __json_sax_parse("[1, 2 3]", 8, sax_tracer(&trace));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, error.code);
+    EXPECT_EQ(6u, error.offset);
+    EXPECT_EQ("[ n:1 n:2", trace.events);
+
+    EXPECT_EQ(JSON_ERROR_INVALID_NUMBER, __json_sax_parse("[01]", 4, sax_tracer(&trace)).code);
+    EXPECT_EQ(JSON_ERROR_INVALID_ESCAPE, __json_sax_parse("[\"\\x\"]", 6, sax_tracer(&trace)).code);
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_EOF, __json_sax_parse("{\"a\": [", 7, sax_tracer(&trace)).code);
+    EXPECT_EQ(JSON_ERROR_TRAILING_DATA, __json_sax_parse("{} []", 5, sax_tracer(&trace)).code);
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_EOF, __json_sax_parse("", 0, sax_tracer(&trace)).code);
+
+    error = __json_sax_parse("{\n\"a\" 1}", 8, sax_tracer(&trace));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, error.code);
+    EXPECT_EQ(2u, error.row);
+    EXPECT_EQ(5u, error.column);
+}
+
+TEST(JsonSaxTest, DepthLimit) {
+    /* Arrange */
+    std::string deep = std::string(200, '[') + std::string(200, ']');
+
+    /* Act & Assert */
+    EXPECT_EQ(JSON_ERROR_NONE, json_sax_parse(deep.data(), deep.size(), .max_depth = 200).code);
+    struct json_error_t error = json_sax_parse(deep.data(), deep.size(), .max_depth = 199);
+    EXPECT_EQ(JSON_ERROR_DEPTH, error.code);
+    EXPECT_EQ(199u, error.offset);
+}
+
+TEST(JsonSaxTest, File) {
+    /* Arrange */
+    char path[] = "/tmp/json_sax_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    std::string data = "[";
+    for (int i = 0; i < 100000; i++)
+        data += std::string(i ? "," : "") + "{\"id\": " + std::to_string(i) + ", \"s\": \"\\\"\"}";
+    data += "]";
+    ASSERT_EQ((ssize_t)data.size(), write(fd, data.data(), data.size()));
+    close(fd);
+    size_t objects = 0;
+
+    /* Act */
+    struct json_error_t error = json_sax_file(path, .start_object = [](void *a) {
+        ++*(size_t *)a;
+        return true;
+    }, .args = &objects);
+
+    /* Assert */
+    EXPECT_EQ(JSON_ERROR_NONE, error.code);
+    EXPECT_EQ(100000u, objects);
+    EXPECT_EQ(JSON_ERROR_IO, json_sax_file("/nonexistent/file.json").code);
+
+    /* Clean */
+    unlink(path);
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "env.hh"
+
+static std::vector<std::string> seq_dump_all(struct json_seq_t *seq) {
+    std::vector<std::string> out;
+    union json_t value;
+
+    while (json_seq_next(seq, &value)) {
+        char *text = json_dumps(value, .indent = -1);
+        out.push_back(text);
+        free(text);
+        json_clean(&value);
+    }
+    return out;
+}
+
+TEST(JsonSeqTest, ConcatenatedValues) {
+    /* Arrange */
+    const std::string data = "{\"a\": 1}{\"b\": [2]}[3]\"s\" 4\ntrue null";
+    struct json_seq_t *seq = json_seq_new(data.data(), data.size());
+
+    /* Act */
+    std::vector<std::string> values = seq_dump_all(seq);
+
+    /* Assert */
+    std::vector<std::string> expected = {"{\"a\": 1}", "{\"b\": [2]}", "[3]", "\"s\"", "4", "true", "null"};
+    EXPECT_EQ(expected, values);
+    EXPECT_EQ(7u, seq->count);
+    EXPECT_EQ(JSON_ERROR_NONE, seq->error.code);
+
+    /* Clean */
+    json_seq_free(seq);
+}
+
+TEST(JsonSeqTest, EmptyInput) {
+    /* Arrange */
+    struct json_seq_t *seq = json_seq_new(" \n ", 3);
+    union json_t value;
+
+    /* Act & Assert */
+    EXPECT_FALSE(json_seq_next(seq, &value));
+    EXPECT_EQ(JT_MISSING, value.type);
+    EXPECT_EQ(JSON_ERROR_NONE, seq->error.code);
+
+    /* Clean */
+    json_seq_free(seq);
+}
+
+TEST(JsonSeqTest, ConcatenatedErrorEndsIteration) {
+    /* Arrange */
+    const std::string data = "[1]\n  x [2]";
+    struct json_seq_t *seq = json_seq_new(data.data(), data.size());
+    union json_t value;
+
+    /* Act & Assert */
+    ASSERT_TRUE(json_seq_next(seq, &value));
+    json_clean(&value);
+
+    EXPECT_FALSE(json_seq_next(seq, &value));
+    EXPECT_EQ(JSON_ERROR_INVALID_CHAR, seq->error.code);
+    EXPECT_EQ(6u, seq->error.offset);
+    EXPECT_EQ(2u, seq->error.row);
+    EXPECT_EQ(3u, seq->error.column);
+
+    EXPECT_FALSE(json_seq_next(seq, &value));
+    EXPECT_EQ(JSON_ERROR_INVALID_CHAR, seq->error.code);
+
+    /* Clean */
+    json_seq_free(seq);
+}
+
+TEST(JsonSeqTest, RecordSeparators) {
+    /* Arrange */
+    const std::string data = "\n\x1e{\"a\": 1}\n\x1e\x1e  \n\x1e[2]\n\x1e\"x\"\n";
+    struct json_seq_t *seq = json_seq_new(data.data(), data.size(), .typed_numbers = true);
+
+    /* Act */
+    std::vector<std::string> values = seq_dump_all(seq);
+
+    /* Assert */
+    std::vector<std::string> expected = {"{\"a\": 1}", "[2]", "\"x\""};
+    EXPECT_TRUE(seq->records);
+    EXPECT_EQ(expected, values);
+    EXPECT_EQ(JSON_ERROR_NONE, seq->error.code);
+
+    /* Clean */
+    json_seq_free(seq);
+}
+
+TEST(JsonSeqTest, BadRecordIsSkipped) {
+    /* Arrange */
+    const std::string data = "\x1e{\"a\":\n\x1e[1]\n\x1e" "1 2\n\x1e" "3\n";
+    struct json_error_t error;
+    struct json_seq_t *seq = json_seq_new(data.data(), data.size(), .error = &error);
+    union json_t value;
+
+    /* Act & Assert */
+    EXPECT_FALSE(json_seq_next(seq, &value));
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_EOF, seq->error.code);
+    EXPECT_EQ(7u, seq->error.offset);
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_EOF, error.code);
+
+    ASSERT_TRUE(json_seq_next(seq, &value));
+    EXPECT_EQ(1u, json_length(value));
+    json_clean(&value);
+
+    EXPECT_FALSE(json_seq_next(seq, &value));
+    EXPECT_EQ(JSON_ERROR_TRAILING_DATA, seq->error.code);
+    EXPECT_EQ(3u, seq->error.row);
+    EXPECT_EQ(4u, seq->error.column);
+
+    ASSERT_TRUE(json_seq_next(seq, &value));
+    EXPECT_EQ(JSON_ERROR_NONE, seq->error.code);
+    json_clean(&value);
+
+    EXPECT_FALSE(json_seq_next(seq, &value));
+    EXPECT_EQ(JSON_ERROR_NONE, seq->error.code);
+    EXPECT_EQ(2u, seq->count);
+
+    /* Clean */
+    json_seq_free(seq);
+}
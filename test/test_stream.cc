@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "env.hh"
+
+static void collect(union json_t value, void *args) { ((std::vector<union json_t> *)args)->push_back(value); }
+
+static std::string dump(union json_t j) {
+    char *text = json_dumps(j, .indent = -1);
+    std::string s = text;
+    free(text);
+    return s;
+}
+
+static void clean_all(std::vector<union json_t> &values) {
+    for (union json_t &v : values)
+        json_clean(&v);
+    values.clear();
+}
+
+TEST(JsonStreamTest, ChunksMatchDeserialize) {
+    /* Arrange */
+    const std::string data = "{\"name\": \"a \\\"quoted\\\" [string]\", \"list\": [1, -2.5e3, true, null, {\"k\": []}], "
+                             "\"nested\": {\"x\": \"\\u00e9\\\\\"}}";
+    union json_t expected = json_deserialize(data.c_str());
+
+    for (size_t chunk : {1, 2, 3, 7, 64, 4096}) {
+        std::vector<union json_t> values;
+        struct json_stream_t *stream = json_stream_new(.callback = collect, .args = &values);
+
+        /* Act */
+        for (size_t i = 0; i < data.size(); i += chunk)
+            ASSERT_EQ(JSON_ERROR_NONE, json_stream_feed(stream, data.data() + i, std::min(chunk, data.size() - i)));
+        EXPECT_EQ(JSON_ERROR_NONE, json_stream_finish(stream));
+
+        /* Assert */
+        ASSERT_EQ(1u, values.size()) << chunk;
+        EXPECT_EQ(dump(expected), dump(values[0])) << chunk;
+
+        /* Clean */
+        clean_all(values);
+        json_stream_free(stream);
+    }
+
+    json_clean(&expected);
+}
+
+TEST(JsonStreamTest, EmitsElementsAsTheyComplete) {
+    /* Arrange */
+    std::vector<union json_t> values;
+    struct json_stream_t *stream = json_stream_new(.callback = collect, .args = &values, .elements = true,
+                                                   .typed_numbers = true);
+
+    /* Act & Assert */
+    json_stream_feed(stream, "[ {\"id\": 1}, \"tw", 16);
+    ASSERT_EQ(1u, values.size());
+    EXPECT_EQ(1, json_get(values[0], "id").i64);
+
+    json_stream_feed(stream, "o\", 12", 6);
+    ASSERT_EQ(2u, values.size());
+    EXPECT_STREQ("two", values[1].text);
+
+    // the number only ends at its delimiter
+    json_stream_feed(stream, "34 ", 3);
+    ASSERT_EQ(3u, values.size());
+    EXPECT_EQ(1234, values[2].i64);
+
+    json_stream_feed(stream, ", [[]]]\n", 8);
+    ASSERT_EQ(4u, values.size());
+    EXPECT_EQ("[[]]", dump(values[3]));
+
+    EXPECT_EQ(JSON_ERROR_NONE, json_stream_finish(stream));
+
+    /* Clean */
+    clean_all(values);
+    json_stream_free(stream);
+}
+
+TEST(JsonStreamTest, ElementsModeKeepsOtherRoots) {
+    std::vector<union json_t> values;
+    struct json_stream_t *stream = json_stream_new(.callback = collect, .args = &values, .elements = true);
+
+    json_stream_feed(stream, "{\"a\": [1]}", 10);
+    EXPECT_EQ(JSON_ERROR_NONE, json_stream_finish(stream));
+    ASSERT_EQ(1u, values.size());
+    EXPECT_EQ(JT_OBJECT, values[0].type);
+
+    clean_all(values);
+    json_stream_free(stream);
+}
+
+TEST(JsonStreamTest, ScalarRootAtEnd) {
+    std::vector<union json_t> values;
+    struct json_stream_t *stream = json_stream_new(.callback = collect, .args = &values);
+
+    json_stream_feed(stream, " 12", 3);
+    json_stream_feed(stream, "3", 1);
+    EXPECT_EQ(0u, values.size());
+    EXPECT_EQ(JSON_ERROR_NONE, json_stream_finish(stream));
+    ASSERT_EQ(1u, values.size());
+    EXPECT_STREQ("123", values[0].text);
+
+    clean_all(values);
+    json_stream_free(stream);
+}
+
+TEST(JsonStreamTest, SequenceOfRoots) {
+    /* Arrange */
+    const std::string data = "{\"a\": [1]}[2]\"s\" 3\x1e[4]\n\x1e" "5\n";
+
+    for (bool elements : {false, true}) {
+        for (size_t chunk : {1, 3, 64}) {
+            std::vector<union json_t> values;
+            struct json_stream_t *stream =
+                json_stream_new(.callback = collect, .args = &values, .elements = elements, .sequence = true);
+
+            /* Act */
+            for (size_t i = 0; i < data.size(); i += chunk)
+                ASSERT_EQ(JSON_ERROR_NONE, json_stream_feed(stream, data.data() + i, std::min(chunk, data.size() - i)));
+            EXPECT_EQ(JSON_ERROR_NONE, json_stream_finish(stream));
+
+            /* Assert */
+            std::vector<std::string> dumped;
+            for (union json_t v : values)
+                dumped.push_back(dump(v));
+            std::vector<std::string> expected = {"{\"a\": [1]}", "[2]", "\"s\"", "3", "[4]", "5"};
+            if (elements)
+                expected = {"{\"a\": [1]}", "2", "\"s\"", "3", "4", "5"};
+            EXPECT_EQ(expected, dumped) << chunk;
+
+            /* Clean */
+            clean_all(values);
+            json_stream_free(stream);
+        }
+    }
+}
+
+TEST(JsonStreamTest, StreamErrors) {
+    struct stream_error_case_t {
+        const char *chunks[3];
+        bool elements;
+        enum json_error_code code;
+        size_t offset;
+        size_t row;
+        size_t column;
+    } cases[] = {
+        {{"[1, 2", ",]"}, true, JSON_ERROR_UNEXPECTED_TOKEN, 6, 1, 7},
+        {{"[1 ", "2]"}, true, JSON_ERROR_UNEXPECTED_TOKEN, 3, 1, 4},
+        {{"[1, {\"a\" 1}]"}, true, JSON_ERROR_UNEXPECTED_TOKEN, 9, 1, 10},
+        {{"{\"a\":\n", " [1, 2,]}"}, false, JSON_ERROR_UNEXPECTED_TOKEN, 13, 2, 8},
+        {{"{}\n", "\n  {}"}, false, JSON_ERROR_TRAILING_DATA, 6, 3, 3},
+        {{"[1, 2]", " 3"}, true, JSON_ERROR_TRAILING_DATA, 7, 1, 8},
+        {{"[1, \"ab"}, true, JSON_ERROR_UNEXPECTED_EOF, 7, 1, 8},
+        {{""}, false, JSON_ERROR_UNEXPECTED_EOF, 0, 1, 1},
+        {{"[tr", "ue, tru]"}, true, JSON_ERROR_INVALID_LITERAL, 7, 1, 8},
+    };
+
+    for (const auto &c : cases) {
+        std::vector<union json_t> values;
+        struct json_stream_t *stream = json_stream_new(.callback = collect, .args = &values, .elements = c.elements);
+        enum json_error_code code = JSON_ERROR_NONE;
+
+        for (const char *chunk : c.chunks) {
+            if (chunk && !code)
+                code = json_stream_feed(stream, chunk, strlen(chunk));
+        }
+        if (!code)
+            code = json_stream_finish(stream);
+
+        EXPECT_EQ(c.code, code) << c.chunks[0];
+        EXPECT_EQ(c.offset, stream->error.offset) << c.chunks[0];
+        EXPECT_EQ(c.row, stream->error.row) << c.chunks[0];
+        EXPECT_EQ(c.column, stream->error.column) << c.chunks[0];
+        // later calls keep failing
+        EXPECT_EQ(c.code, json_stream_feed(stream, "1", 1));
+
+        clean_all(values);
+        json_stream_free(stream);
+    }
+}
+
+TEST(JsonStreamTest, BuffersOnlyTheCutToken) {
+    /* Arrange */
+    std::string data = "{\"items\": [";
+    for (int i = 0; i < 20000; i++)
+        data += (i ? ", {\"id\": " : "{\"id\": ") + std::to_string(i) + ", \"name\": \"item \\\"" + std::to_string(i) +
+                "\\\"\", \"tags\": [true, false, null]}";
+    data += "], \"tail\": \"" + std::string(10000, 'x') + "\\n\"}";
+    union json_t expected = json_deserialize(data.c_str());
+    std::vector<union json_t> values;
+    struct json_stream_t *stream = json_stream_new(.callback = collect, .args = &values);
+    size_t chunk = 1000, most = 0;
+
+    /* Act */
+    for (size_t i = 0; i < data.size(); i += chunk) {
+        ASSERT_EQ(JSON_ERROR_NONE, json_stream_feed(stream, data.data() + i, std::min(chunk, data.size() - i)));
+        if (i + chunk < data.size() - 10100)
+            most = std::max(most, stream->len);
+    }
+    EXPECT_EQ(JSON_ERROR_NONE, json_stream_finish(stream));
+
+    /* Assert */
+    // the single root is parsed as it arrives, only a token cut by a chunk end waits
+    EXPECT_LT(most, 100u);
+    ASSERT_EQ(1u, values.size());
+    EXPECT_EQ(dump(expected), dump(values[0]));
+
+    /* Clean */
+    clean_all(values);
+    json_clean(&expected);
+    json_stream_free(stream);
+}
+
+TEST(JsonStreamTest, ReportsErrorsBeforeTheValueEnds) {
+    std::vector<union json_t> values;
+    struct json_stream_t *stream = json_stream_new(.callback = collect, .args = &values, .max_depth = 3);
+
+    EXPECT_EQ(JSON_ERROR_NONE, json_stream_feed(stream, "{\"a\": [[1], ", 12));
+    EXPECT_EQ(JSON_ERROR_DEPTH, json_stream_feed(stream, "[[", 2));
+    EXPECT_EQ(13u, stream->error.offset);
+    EXPECT_EQ(0u, values.size());
+    json_stream_free(stream);
+
+    stream = json_stream_new(.callback = collect, .args = &values);
+    EXPECT_EQ(JSON_ERROR_NONE, json_stream_feed(stream, "[\"ok\", \"a\\", 10));
+    EXPECT_EQ(JSON_ERROR_INVALID_ESCAPE, json_stream_feed(stream, "x\", ", 4));
+    EXPECT_EQ(7u, stream->error.offset);
+    json_stream_free(stream);
+}
+
+TEST(JsonStreamTest, GluedByteFailsLikeDeserialize) {
+    const char *chunks[][2] = {{"4x7", NULL}, {"4", "x7"}, {"[tru", "ex]"}};
+
+    for (const auto &c : chunks) {
+        std::vector<union json_t> values;
+        struct json_stream_t *stream = json_stream_new(.callback = collect, .args = &values);
+        enum json_error_code code = json_stream_feed(stream, c[0], strlen(c[0]));
+
+        if (!code && c[1])
+            code = json_stream_feed(stream, c[1], strlen(c[1]));
+        if (!code)
+            code = json_stream_finish(stream);
+
+        std::string text = std::string(c[0]) + (c[1] ? c[1] : "");
+        struct json_error_t error = {};
+        union json_t j = json_deserialize_n_with(text.c_str(), text.size(), .error = &error);
+
+        EXPECT_EQ(JSON_ERROR_INVALID_CHAR, code) << text;
+        EXPECT_EQ(error.code, code) << text;
+        EXPECT_EQ(error.offset, stream->error.offset) << text;
+        EXPECT_EQ(0u, values.size()) << text;
+
+        json_clean(&j);
+        json_stream_free(stream);
+    }
+}
+
+TEST(JsonStreamTest, LoadFromPipe) {
+    /* Arrange */
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    const char *data = "{\"a\": [1, 2, 3], \"b\": \"pipe\"}";
+    ASSERT_EQ((ssize_t)strlen(data), write(fds[1], data, strlen(data)));
+    close(fds[1]);
+    FILE *f = fdopen(fds[0], "r");
+
+    /* Act */
+    union json_t j = json_load(f);
+
+    /* Assert */
+    EXPECT_EQ(JT_OBJECT, j.type);
+    EXPECT_STREQ("pipe", json_get(j, "b").text);
+    EXPECT_EQ(3, json_length(json_get(j, "a")));
+
+    /* Clean */
+    fclose(f);
+    json_clean(&j);
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "env.hh"
+#include "json_simd.h"
+
+static struct json_error_t validate(const char *text) { return json_validate(text, strlen(text)); }
+
+TEST(JsonValidateTest, ValidDocuments) {
+    const char *data[] = {
+        "0", "-1.5e3", "\"\"", "true", "false", "null", "[]", "{}", " [ ] ",
+        "{\"a\": [1, {\"b\": null}], \"c\": \"x\\ny\\u00e9\\ud83d\\ude00\"}",
+        "[[[[[]]]], {\"k\": {}}]",
+        "\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"",
+    };
+
+    for (const char *text : data) {
+        EXPECT_EQ(JSON_ERROR_NONE, validate(text).code) << text;
+    }
+}
+
+TEST(JsonValidateTest, MatchesParserErrors) {
+    for (const struct error_case_t &c : error_cases) {
+        struct json_error_t error = validate(c.text);
+
+        EXPECT_EQ(c.code, error.code) << c.text << ": " << json_error2str(error.code);
+        EXPECT_EQ(c.offset, error.offset) << c.text;
+    }
+}
+
+TEST(JsonValidateTest, InvalidUtf8) {
+    const struct error_case_t cases[] = {
+        {"\"\x80\"", JSON_ERROR_INVALID_UTF8, 1},
+        {"\"ab\xc0\xaf\"", JSON_ERROR_INVALID_UTF8, 3},         // overlong '/'
+        {"\"\xe0\x80\xaf\"", JSON_ERROR_INVALID_UTF8, 1},       // overlong
+        {"\"\xed\xa0\x80\"", JSON_ERROR_INVALID_UTF8, 1},       // surrogate
+        {"\"\xf4\x90\x80\x80\"", JSON_ERROR_INVALID_UTF8, 1},   // above U+10FFFF
+        {"\"\xf5\x80\x80\x80\"", JSON_ERROR_INVALID_UTF8, 1},
+        {"\"\xe2\x82\"", JSON_ERROR_INVALID_UTF8, 1},           // truncated
+        {"{\"12345678\xff\": 1}", JSON_ERROR_INVALID_UTF8, 10}, // after the ASCII fast path
+        {"[\xc3\xa9]", JSON_ERROR_INVALID_CHAR, 1},             // outside a string
+    };
+
+    for (const struct error_case_t &c : cases) {
+        struct json_error_t error = validate(c.text);
+
+        EXPECT_EQ(c.code, error.code) << c.text;
+        EXPECT_EQ(c.offset, error.offset) << c.text;
+    }
+}
+
+TEST(JsonValidateTest, ParseOption) {
+    const struct error_case_t cases[] = {
+        {"\"\x80\"", JSON_ERROR_INVALID_UTF8, 1},
+        {"{\"k\": [\"ok\", \"\\n\xe2\x82\"]}", JSON_ERROR_INVALID_UTF8, 16},
+        {"{\"\xed\xa0\x80\": 1}", JSON_ERROR_INVALID_UTF8, 2},
+        {"[\"caf\xc3\xa9\", \"\xf0\x9f\x98\x80\"]", JSON_ERROR_NONE, 0},
+    };
+
+    for (const struct error_case_t &c : cases) {
+        struct json_error_t error;
+
+        /* Act */
+        union json_t j = json_deserialize_with(c.text, .error = &error, .validate_utf8 = true);
+
+        /* Assert */
+        EXPECT_EQ(c.code, error.code) << c.text;
+        EXPECT_EQ(c.offset, error.offset) << c.text;
+        json_clean(&j);
+    }
+
+    // off by default
+    union json_t j = json_deserialize_with("\"\x80\"");
+    EXPECT_EQ(JT_STRING, j.type);
+    json_clean(&j);
+}
+
+/* Random text of valid sequences, one of them cut or damaged in some rounds */
+static std::string random_utf8(size_t len) {
+    static const char *const sequences[] = {"a", "~", "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80", "\xed\x9f\xbf",
+                                            "\xef\xbf\xbf", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf", "\xe2\x82\xac"};
+    std::string text;
+
+    while (text.size() < len)
+        text += sequences[rand() % 10];
+    if (!text.empty() && rand() % 2)
+        text[rand() % text.size()] = (char)(rand() % 256);
+    if (rand() % 4 == 0)
+        text.resize(rand() % (text.size() + 1));
+    return text;
+}
+
+TEST(JsonValidateTest, Utf8KernelsAgreeWithScalar) {
+    /* Arrange */
+    const char *kernels[] = {"sse4.2", "avx2", "avx512"};
+    std::string active = json_simd_kernel_name();
+    srand(11);
+
+    for (const char *kernel : kernels) {
+        if (!json_simd_use(kernel))
+            continue;
+
+        for (int round = 0; round < 20000; round++) {
+            std::string text = random_utf8(rand() % 200);
+            const uint8_t *p = (const uint8_t *)text.data();
+
+            /* Act & Assert */
+            ASSERT_EQ(json_utf8_error_offset(p, text.size()) == text.size(), json_validate_utf8(p, text.size()))
+                << kernel << " " << testing::PrintToString(text);
+        }
+
+        // every lead cut at every vector edge
+        for (size_t at : {14, 15, 16, 30, 31, 32, 62, 63, 64, 127, 128}) {
+            for (const char *lead : {"\xc3", "\xe2\x82", "\xf0\x9f\x98", "\xed\xa0\x80"}) {
+                std::string text = std::string(at, 'x') + lead;
+                EXPECT_FALSE(json_validate_utf8((const uint8_t *)text.data(), text.size())) << kernel << " " << at;
+                text += "x";
+                EXPECT_FALSE(json_validate_utf8((const uint8_t *)text.data(), text.size())) << kernel << " " << at;
+            }
+        }
+    }
+
+    EXPECT_TRUE(json_simd_use(active.c_str()));
+}
+
+TEST(JsonValidateTest, UsesLength) {
+    /* Arrange */
+    const char data[] = "[1, 2]3, 4]";
+    const char nul[] = "[\"a\0b\"]";
+
+    /* Act & Assert */
+    EXPECT_EQ(JSON_ERROR_NONE, json_validate(data, 6).code);
+    EXPECT_EQ(JSON_ERROR_TRAILING_DATA, json_validate(data, 7).code);
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_EOF, json_validate(data, 5).code);
+    EXPECT_EQ(JSON_ERROR_INVALID_STRING, json_validate(nul, sizeof(nul) - 1).code);
+}
+
+TEST(JsonValidateTest, RowColumn) {
+    struct json_error_t error = validate("[\n  1,\n  2\n  3\n]");
+
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, error.code);
+    EXPECT_EQ(4u, error.row);
+    EXPECT_EQ(3u, error.column);
+}
+
+TEST(JsonValidateTest, MaxDepth) {
+    std::string ok = std::string(JSON_MAX_DEPTH, '[') + std::string(JSON_MAX_DEPTH, ']');
+    std::string deep = std::string(JSON_MAX_DEPTH + 1, '[') + std::string(JSON_MAX_DEPTH + 1, ']');
+    std::string mixed = "{\"a\": [" + std::string(64, '[') + std::string(64, ']') + "}]";
+
+    EXPECT_EQ(JSON_ERROR_NONE, validate(ok.c_str()).code);
+    EXPECT_EQ(JSON_ERROR_DEPTH, validate(deep.c_str()).code);
+    EXPECT_EQ(JSON_MAX_DEPTH, validate(deep.c_str()).offset);
+    EXPECT_EQ(JSON_ERROR_UNEXPECTED_TOKEN, validate(mixed.c_str()).code);
+}